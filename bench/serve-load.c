@@ -0,0 +1,108 @@
+/****************************************
+ * serve-load.c                         *
+ * load test for veclisp -s             *
+ *                                      *
+ * license: MIT                         *
+ ****************************************/
+
+/* each client thread opens a connection per request, sends the
+   expression, half-closes and reads the reply to the end. prints
+   throughput and latency percentiles over all requests. */
+#define _GNU_SOURCE
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <time.h>
+#include <unistd.h>
+#include <pthread.h>
+
+struct client {
+  pthread_t thread;
+  int64_t requests, failures, *latencies;
+};
+struct sockaddr_un server;
+const char *expr;
+size_t expr_len;
+int verbose;
+
+int64_t now_ns(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (int64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+int request(void) {
+  char buf[4096];
+  ssize_t got;
+  size_t sent = 0;
+  int fd;
+  if ((fd = socket(AF_UNIX, SOCK_STREAM, 0)) < 0) return 1;
+  if (connect(fd, (struct sockaddr *)&server, sizeof(server))) {
+    close(fd);
+    return 1;
+  }
+  while (sent < expr_len) {
+    if ((got = write(fd, expr + sent, expr_len - sent)) <= 0) {
+      close(fd);
+      return 1;
+    }
+    sent += got;
+  }
+  shutdown(fd, SHUT_WR);
+  while ((got = read(fd, buf, sizeof(buf))) > 0) {
+    if (verbose) fwrite(buf, 1, got, stdout);
+  }
+  close(fd);
+  return got < 0;
+}
+void *run_client(void *arg) {
+  struct client *c = arg;
+  int64_t i, start;
+  for (i = 0; i < c->requests; ++i) {
+    start = now_ns();
+    if (request()) c->failures++;
+    c->latencies[i] = now_ns() - start;
+  }
+  return NULL;
+}
+int compare_int64(const void *a, const void *b) {
+  int64_t x = *(const int64_t *)a, y = *(const int64_t *)b;
+  return x < y ? -1 : x > y;
+}
+int main(int argc, char **argv) {
+  int64_t clients, requests, i, total, failures = 0, start, elapsed, *all;
+  struct client *cs;
+  if (argc < 5) {
+    fputs("usage: serve-load socket clients requests-per-client expr [-v]\n", stderr);
+    return 2;
+  }
+  memset(&server, 0, sizeof(server));
+  server.sun_family = AF_UNIX;
+  strncpy(server.sun_path, argv[1], sizeof(server.sun_path) - 1);
+  clients = atoll(argv[2]);
+  requests = atoll(argv[3]);
+  expr = argv[4];
+  expr_len = strlen(expr);
+  verbose = argc > 5 && !strcmp(argv[5], "-v");
+  total = clients * requests;
+  cs = calloc(clients, sizeof(*cs));
+  all = malloc(sizeof(*all) * total);
+  start = now_ns();
+  for (i = 0; i < clients; ++i) {
+    cs[i].requests = requests;
+    cs[i].latencies = all + i * requests;
+    pthread_create(&cs[i].thread, NULL, run_client, &cs[i]);
+  }
+  for (i = 0; i < clients; ++i) {
+    pthread_join(cs[i].thread, NULL);
+    failures += cs[i].failures;
+  }
+  elapsed = now_ns() - start;
+  qsort(all, total, sizeof(*all), compare_int64);
+  printf("%ld requests, %ld failed, %.0f req/s\n", (long)total, (long)failures, total * 1e9 / elapsed);
+  printf("latency us: p50 %.1f  p90 %.1f  p99 %.1f  max %.1f\n",
+         all[total / 2] / 1e3, all[total * 9 / 10] / 1e3, all[total * 99 / 100] / 1e3, all[total - 1] / 1e3);
+  return failures != 0;
+}
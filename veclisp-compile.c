@@ -0,0 +1,536 @@
+/****************************************
+ * veclisp-compile.c                    *
+ * translates veclisp files to C        *
+ *                                      *
+ * license: MIT                         *
+ ****************************************/
+
+/* usage: veclisp-compile file.l... > out.c
+
+   every top-level (set 'NAME '((ARGS...) BODY...)) becomes a C function
+   registered under NAME as a closure taking its arguments evaluated.
+   arithmetic, comparisons, if and quote run as C; other calls go
+   through the head symbol's binding like the evaluator's do. other
+   top-level forms are kept as data and evaluated in order. out.c
+   defines veclisp_compiled, which veclisp.c runs after setting up the
+   root scope when built with -DVECLISP_COMPILED. data is built in C,
+   so nothing is read at startup. */
+#define _GNU_SOURCE
+#include <stdarg.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "veclisp.h"
+
+struct buf {
+  char *data;
+  size_t used, allocated;
+};
+/* the natives compiled inline, with how */
+struct op {
+  veclisp_native_func native;
+  const char *name;
+  enum { ARITH, CMP, IF, QUOTE } kind;
+  const char *c;
+} ops[] = {
+  { veclisp_n_add, "veclisp_n_add", ARITH, "+=" },
+  { veclisp_n_sub, "veclisp_n_sub", ARITH, "-=" },
+  { veclisp_n_mul, "veclisp_n_mul", ARITH, "*=" },
+  { veclisp_n_eq, "veclisp_n_eq", CMP, "==" },
+  { veclisp_n_lt, "veclisp_n_lt", CMP, "<" },
+  { veclisp_n_gt, "veclisp_n_gt", CMP, ">" },
+  { veclisp_n_lte, "veclisp_n_lte", CMP, "<=" },
+  { veclisp_n_gte, "veclisp_n_gte", CMP, ">=" },
+  { veclisp_n_if, "veclisp_n_if", IF, NULL },
+  { veclisp_n_quote, "veclisp_n_quote", QUOTE, NULL },
+};
+#define OP_COUNT (sizeof(ops) / sizeof(ops[0]))
+/* the function being compiled */
+struct fn {
+  struct buf decls, body;
+  struct veclisp_cell names;
+  int64_t temps, indent;
+  char *guards[OP_COUNT];
+  struct op *guard_ops[OP_COUNT];
+  int64_t guard_count;
+};
+struct buf constants, prototypes, functions, load;
+int64_t constant_count, function_count, nil_constant = -1;
+/* every top-level form, read before any is compiled, and the functions
+   defined among them by name */
+struct {
+  struct veclisp_cell *forms;
+  const char **paths;
+  int64_t count, allocated;
+} program;
+struct {
+  char **syms;
+  int64_t *ids;
+  int64_t count, allocated;
+} defined;
+/* symbols, pairs and vectors already among the constants, by address */
+struct {
+  void **keys;
+  int64_t *indices;
+  int64_t used, allocated;
+} seen;
+struct veclisp_scope *root;
+
+void put(struct buf *b, const char *fmt, ...) {
+  va_list ap;
+  int n;
+  for (;;) {
+    va_start(ap, fmt);
+    n = vsnprintf(b->data + b->used, b->allocated - b->used, fmt, ap);
+    va_end(ap);
+    if (n >= 0 && b->used + n < b->allocated) break;
+    b->allocated = b->allocated ? b->allocated * 2 + n : 4096;
+    b->data = realloc(b->data, b->allocated);
+  }
+  b->used += n;
+}
+void indent(struct fn *f) {
+  put(&f->body, "%*s", (int)(f->indent * 2), "");
+}
+/* writes s as a c string literal */
+void put_string(struct buf *b, const unsigned char *s, size_t len) {
+  size_t i;
+  put(b, "\"");
+  for (i = 0; i < len; ++i) {
+    if (s[i] == '"' || s[i] == '\\') put(b, "\\%c", s[i]);
+    else if (s[i] >= ' ' && s[i] < 127 && s[i] != '?') put(b, "%c", s[i]);
+    else put(b, "\\%03o", s[i]);
+  }
+  put(b, "\"");
+}
+int64_t *seen_slot(void *key) {
+  int64_t i;
+  if (seen.used * 2 >= seen.allocated) {
+    void **keys = seen.keys;
+    int64_t *indices = seen.indices, allocated = seen.allocated;
+    seen.allocated = allocated ? allocated * 2 : 1024;
+    seen.keys = calloc(seen.allocated, sizeof(*seen.keys));
+    seen.indices = calloc(seen.allocated, sizeof(*seen.indices));
+    seen.used = 0;
+    for (i = 0; i < allocated; ++i) {
+      if (keys[i] != NULL) *seen_slot(keys[i]) = indices[i];
+    }
+    free(keys);
+    free(indices);
+  }
+  for (i = ((uint64_t)key >> 4) & (seen.allocated - 1); seen.keys[i] != NULL; i = (i + 1) & (seen.allocated - 1)) {
+    if (seen.keys[i] == key) return &seen.indices[i];
+  }
+  seen.keys[i] = key;
+  seen.indices[i] = -1;
+  seen.used++;
+  return &seen.indices[i];
+}
+/* the index in K of a constant equal to value, building it if needed.
+   the parts of one form share the cells built for the whole. */
+int64_t constant(struct veclisp_cell value) {
+  int64_t i, head, tail, *slot = NULL, *elems;
+  switch (value.type) {
+  case VECLISP_INT:
+    put(&constants, "  K[%ld] = veclisp_from_int((int64_t)%lluULL);\n", (long)constant_count, (unsigned long long)value.as.integer);
+    return constant_count++;
+  case VECLISP_SYM:
+    if (*(slot = seen_slot(value.as.sym)) >= 0) return *slot;
+    put(&constants, "  K[%ld] = veclisp_from_sym(", (long)constant_count);
+    put_string(&constants, (unsigned char *)value.as.sym, strlen(value.as.sym));
+    put(&constants, ");\n");
+    return *slot = constant_count++;
+  case VECLISP_BYTES:
+    put(&constants, "  K[%ld] = veclisp_from_bytes(", (long)constant_count);
+    put_string(&constants, value.as.bytes->data, value.as.bytes->length);
+    put(&constants, ", %ld);\n", (long)value.as.bytes->length);
+    return constant_count++;
+  case VECLISP_PAIR:
+    if (value.as.pair == NULL) {
+      if (nil_constant < 0) {
+        put(&constants, "  K[%ld] = veclisp_nil();\n", (long)constant_count);
+        nil_constant = constant_count++;
+      }
+      return nil_constant;
+    }
+    if (*(slot = seen_slot(value.as.pair)) >= 0) return *slot;
+    head = constant(value.as.pair[0]);
+    tail = constant(value.as.pair[1]);
+    put(&constants, "  K[%ld] = veclisp_cons(K[%ld], K[%ld]);\n", (long)constant_count, (long)head, (long)tail);
+    return *seen_slot(value.as.pair) = constant_count++;
+  case VECLISP_VEC:
+    if (*(slot = seen_slot(value.as.vec)) >= 0) return *slot;
+    elems = malloc(sizeof(*elems) * (VECLISP_VLEN(value.as.vec) + 1));
+    FORVEC(i, value.as.vec) elems[i] = constant(VECLISP_VELEMS(value.as.vec)[i]);
+    put(&constants, "  K[%ld].type = VECLISP_VEC;\n  K[%ld].as.vec = veclisp_alloc_vec(%ld);\n",
+        (long)constant_count, (long)constant_count, (long)VECLISP_VLEN(value.as.vec));
+    FORVEC(i, value.as.vec) put(&constants, "  K[%ld].as.vec[%ld] = K[%ld];\n", (long)constant_count, (long)i, (long)elems[i]);
+    free(elems);
+    return *seen_slot(value.as.vec) = constant_count++;
+  default:
+    fputs("veclisp-compile: value cannot be compiled\n", stderr);
+    exit(1);
+  }
+}
+int64_t param(struct fn *f, char *sym) {
+  struct veclisp_cell *p;
+  int64_t i = 0;
+  FORPAIR(p, &f->names) {
+    if (p->as.pair[0].as.sym == sym) return i;
+    ++i;
+  }
+  return -1;
+}
+/* the inlined native a call form's head is bound to now, noted as one
+   the compiled function relies on */
+struct op *inline_op(struct fn *f, struct veclisp_cell head) {
+  struct veclisp_cell value;
+  int64_t i, j;
+  if (head.type != VECLISP_SYM || param(f, head.as.sym) >= 0) return NULL;
+  if (veclisp_scope_lookup(root, head.as.sym, &value) || value.type != VECLISP_INT) return NULL;
+  for (i = 0; i < (int64_t)OP_COUNT; ++i) {
+    if (value.as.integer != (int64_t)ops[i].native) continue;
+    for (j = 0; j < f->guard_count; ++j) {
+      if (f->guards[j] == head.as.sym) return &ops[i];
+    }
+    if (f->guard_count == (int64_t)OP_COUNT) return NULL;
+    f->guards[f->guard_count] = head.as.sym;
+    f->guard_ops[f->guard_count++] = &ops[i];
+    return &ops[i];
+  }
+  return NULL;
+}
+int64_t defined_id(char *sym) {
+  int64_t i;
+  for (i = defined.count - 1; i >= 0; --i) {
+    if (defined.syms[i] == sym) return defined.ids[i];
+  }
+  return -1;
+}
+void temp(struct fn *f, char *name, const char *decl) {
+  sprintf(name, "t%ld", (long)f->temps++);
+  put(&f->decls, "  %s %s;\n", decl, name);
+}
+void fail(struct fn *f, const char *call, const char *err) {
+  indent(f);
+  put(&f->body, "if (%s) {\n", call);
+  indent(f);
+  put(&f->body, "  *result = %s;\n", err);
+  indent(f);
+  put(&f->body, "  return 1;\n");
+  indent(f);
+  put(&f->body, "}\n");
+}
+/* emits statements leaving the value of form in target, evaluated in
+   scope. an error takes on the value of err, as the outermost native
+   in progress would leave it, or is itself the result when err is
+   NULL. */
+void expr(struct fn *f, struct veclisp_cell form, const char *scope, const char *target, const char *err) {
+  struct veclisp_cell *a, *args;
+  struct op *op;
+  char x[24], y[24], s[24], at[24], value[96], branch[64], call[256];
+  int64_t i, n = 0, k;
+  switch (form.type) {
+  case VECLISP_INT:
+    indent(f);
+    put(&f->body, "%s = veclisp_from_int((int64_t)%lluULL);\n", target, (unsigned long long)form.as.integer);
+    return;
+  case VECLISP_SYM:
+    indent(f);
+    if ((i = param(f, form.as.sym)) >= 0) put(&f->body, "%s = b[%ld].value;\n", target, (long)i);
+    else put(&f->body, "veclisp_scope_lookup(%s, K[%ld].as.sym, &%s);\n", scope, (long)constant(form), target);
+    return;
+  case VECLISP_BYTES:
+    indent(f);
+    put(&f->body, "%s = K[%ld];\n", target, (long)constant(form));
+    return;
+  case VECLISP_PAIR:
+    if (form.as.pair != NULL) break;
+    indent(f);
+    put(&f->body, "%s = veclisp_nil();\n", target);
+    return;
+  default:
+    snprintf(call, sizeof(call), "veclisp_eval(%s, K[%ld], &%s)", scope, (long)constant(form), target);
+    fail(f, call, err ? err : target);
+    return;
+  }
+  args = &form.as.pair[1];
+  op = inline_op(f, form.as.pair[0]);
+  if (op != NULL && op->kind == QUOTE) {
+    indent(f);
+    put(&f->body, "%s = K[%ld].as.pair[1];\n", target, (long)constant(form));
+    return;
+  }
+  FORPAIR(a, args) ++n;
+  if (a->type != VECLISP_PAIR || (op == NULL && form.as.pair[0].type != VECLISP_SYM)
+      || (op != NULL && op->kind == CMP && n != 2) || (op != NULL && op->kind == IF && n < 2)) {
+    snprintf(call, sizeof(call), "veclisp_eval(%s, K[%ld], &%s)", scope, (long)constant(form), target);
+    fail(f, call, err ? err : target);
+  } else if (op != NULL && op->kind == ARITH) {
+    indent(f);
+    put(&f->body, "%s = veclisp_from_int(%d);\n", target, op->native == veclisp_n_mul);
+    temp(f, x, "struct veclisp_cell");
+    FORPAIR(a, args) {
+      expr(f, a->as.pair[0], scope, x, err ? err : target);
+      indent(f);
+      put(&f->body, "%s.as.integer %s %s.as.integer;\n", target, op->c, x);
+    }
+  } else if (op != NULL && op->kind == CMP) {
+    temp(f, x, "struct veclisp_cell");
+    temp(f, y, "struct veclisp_cell");
+    expr(f, args->as.pair[0], scope, x, err);
+    expr(f, args->as.pair[1].as.pair[0], scope, y, err);
+    indent(f);
+    put(&f->body, "if (%s.type == VECLISP_INT && %s.type == VECLISP_INT ? %s.as.integer %s %s.as.integer : veclisp_compare(%s, %s) %s 0) {\n",
+        x, y, x, op->c, y, x, y, op->c);
+    indent(f);
+    put(&f->body, "  %s.type = VECLISP_SYM;\n", target);
+    indent(f);
+    put(&f->body, "  %s.as.sym = VECLISP_T;\n", target);
+    indent(f);
+    put(&f->body, "} else %s = veclisp_nil();\n", target);
+  } else if (op != NULL) {
+    /* if binds @ to the test in a scope of its own, which branches
+       using only parameters never read */
+    temp(f, s, "struct veclisp_scope __attribute__((unused))");
+    temp(f, at, "struct veclisp_bindings");
+    snprintf(value, sizeof(value), "%s.value", at);
+    if (err == NULL) {
+      indent(f);
+      put(&f->body, "%s = veclisp_nil();\n", target);
+    }
+    expr(f, args->as.pair[0], scope, value, err ? err : target);
+    indent(f);
+    put(&f->body, "%s.bindings = &%s;\n", s, at);
+    indent(f);
+    put(&f->body, "%s.next = %s;\n", s, scope);
+    indent(f);
+    put(&f->body, "%s.sym = VECLISP_AT;\n", at);
+    indent(f);
+    put(&f->body, "%s.next = NULL;\n", at);
+    indent(f);
+    put(&f->body, "if (%s.type == VECLISP_PAIR && %s.as.pair == NULL) {\n", value, value);
+    snprintf(branch, sizeof(branch), "&%s", s);
+    f->indent++;
+    a = &args->as.pair[1].as.pair[1];
+    if (a->type == VECLISP_PAIR && a->as.pair != NULL) expr(f, a->as.pair[0], branch, target, err);
+    else {
+      indent(f);
+      put(&f->body, "%s = veclisp_nil();\n", target);
+    }
+    f->indent--;
+    indent(f);
+    put(&f->body, "} else {\n");
+    f->indent++;
+    expr(f, args->as.pair[1].as.pair[0], branch, target, err);
+    f->indent--;
+    indent(f);
+    put(&f->body, "}\n");
+  } else {
+    /* a call through the head symbol's binding */
+    k = constant(form);
+    temp(f, x, "struct veclisp_cell");
+    y[0] = 0;
+    if (n > 0) {
+      sprintf(y, "t%ld", (long)f->temps++);
+      put(&f->decls, "  struct veclisp_cell %s[%ld];\n", y, (long)n);
+    }
+    indent(f);
+    put(&f->body, "if (veclisp_call_head(%s, K[%ld].as.pair, &%s)) {\n", scope, (long)k, x);
+    f->indent++;
+    i = 0;
+    FORPAIR(a, args) {
+      snprintf(value, sizeof(value), "%s[%ld]", y, (long)i++);
+      expr(f, a->as.pair[0], scope, value, err);
+    }
+    snprintf(call, sizeof(call), "veclisp_call_apply(%s, &%s, %s, %ld, &%s)", scope, x, n > 0 ? y : "NULL", (long)n, target);
+    if ((i = defined_id(form.as.pair[0].as.sym)) >= 0) {
+      /* still the function this program defines: call it directly */
+      if (n > 0) {
+        sprintf(s, "t%ld", (long)f->temps++);
+        put(&f->decls, "  struct veclisp_cell %s[%ld];\n", s, (long)(2 * n));
+      }
+      indent(f);
+      put(&f->body, "if (%s.as.pair[0].type == VECLISP_INT && %s.as.pair[0].as.integer == (int64_t)compiled%ld) {\n", x, x, (long)i);
+      f->indent++;
+      snprintf(value, sizeof(value), "veclisp_call_list(%s, %s, %ld)", s, y, (long)n);
+      snprintf(call, sizeof(call), "compiled%ld(%s, %s.as.pair[1], %s, &%s)", (long)i, scope, x, n > 0 ? value : "veclisp_nil()", target);
+      fail(f, call, err ? err : target);
+      f->indent--;
+      indent(f);
+      put(&f->body, "} else {\n");
+      f->indent++;
+      snprintf(call, sizeof(call), "veclisp_call_apply(%s, &%s, %s, %ld, &%s)", scope, x, n > 0 ? y : "NULL", (long)n, target);
+      fail(f, call, err ? err : target);
+      f->indent--;
+      indent(f);
+      put(&f->body, "}\n");
+    } else fail(f, call, err ? err : target);
+    f->indent--;
+    indent(f);
+    put(&f->body, "} else {\n");
+    f->indent++;
+    snprintf(call, sizeof(call), "veclisp_call_rest(%s, &%s, K[%ld].as.pair, &%s)", scope, x, (long)k, target);
+    fail(f, call, err ? err : target);
+    f->indent--;
+    indent(f);
+    put(&f->body, "}\n");
+  }
+}
+/* (set 'NAME '((ARGS...) BODY...)) with a call to the native set */
+int definition_p(struct veclisp_cell form) {
+  struct veclisp_cell value, *a, *names;
+  int64_t n = 0;
+  if (form.type != VECLISP_PAIR || form.as.pair == NULL || form.as.pair[0].type != VECLISP_SYM) return 0;
+  if (veclisp_scope_lookup(root, form.as.pair[0].as.sym, &value) || value.type != VECLISP_INT
+      || value.as.integer != (int64_t)veclisp_n_set) return 0;
+  FORPAIR(a, &form.as.pair[1]) {
+    if (a->as.pair[0].type != VECLISP_PAIR || a->as.pair[0].as.pair == NULL
+        || a->as.pair[0].as.pair[0].type != VECLISP_SYM || a->as.pair[0].as.pair[0].as.sym != VECLISP_QUOTE)
+      return 0;
+    ++n;
+  }
+  if (n != 2 || a->type != VECLISP_PAIR) return 0;
+  if (form.as.pair[1].as.pair[0].as.pair[1].type != VECLISP_SYM) return 0;
+  value = form.as.pair[1].as.pair[1].as.pair[0].as.pair[1];
+  if (value.type != VECLISP_PAIR || value.as.pair == NULL || value.as.pair[0].type != VECLISP_PAIR
+      || value.as.pair[0].as.pair == NULL) return 0;
+  FORPAIR(names, &value.as.pair[0]) {
+    if (names->as.pair[0].type != VECLISP_SYM || names->as.pair[0].as.sym == VECLISP_AT
+        || names->as.pair[0].as.sym == VECLISP_UPVAL) return 0;
+  }
+  return names->type == VECLISP_PAIR;
+}
+void compile_definition(struct veclisp_cell form) {
+  struct veclisp_cell name = form.as.pair[1].as.pair[0].as.pair[1];
+  struct veclisp_cell lambda = form.as.pair[1].as.pair[1].as.pair[0].as.pair[1];
+  struct veclisp_cell *p;
+  struct fn f;
+  int64_t i, n = 0, id = function_count++, k = constant(lambda);
+  memset(&f, 0, sizeof(f));
+  f.names = lambda.as.pair[0];
+  f.indent = 1;
+  FORPAIR(p, &f.names) {
+    put(&constants, "  N%ld[%ld] = K[%ld].as.sym;\n", (long)id, (long)n, (long)constant(p->as.pair[0]));
+    ++n;
+  }
+  put(&f.decls, "  struct veclisp_cell t;\n");
+  indent(&f);
+  put(&f.body, "t = veclisp_nil();\n");
+  FORPAIR(p, &lambda.as.pair[1]) expr(&f, p->as.pair[0], "&scope", "t", NULL);
+  put(&functions, "static char *N%ld[%ld];\n", (long)id, (long)n);
+  if (f.guard_count > 0) {
+    put(&functions, "static const char *G%ld[] = {", (long)id);
+    for (i = 0; i < f.guard_count; ++i) {
+      put(&functions, i ? ", " : " ");
+      put_string(&functions, (unsigned char *)f.guards[i], strlen(f.guards[i]));
+    }
+    put(&functions, " };\nstatic veclisp_native_func F%ld[] = {", (long)id);
+    for (i = 0; i < f.guard_count; ++i) put(&functions, "%s%s", i ? ", " : " ", f.guard_ops[i]->name);
+    put(&functions, " };\n");
+  }
+  put(&prototypes, "static int compiled%ld(struct veclisp_scope *, struct veclisp_cell, struct veclisp_cell, struct veclisp_cell *);\n", (long)id);
+  put(&functions, "/* %s */\n", name.as.sym);
+  put(&functions, "static int compiled%ld(struct veclisp_scope *parent, struct veclisp_cell data, struct veclisp_cell args, struct veclisp_cell *result) {\n", (long)id);
+  /* a body of only parameters and natives never reads scope */
+  put(&functions, "  struct veclisp_scope __attribute__((unused)) scope;\n  struct veclisp_bindings b[%ld];\n%.*s", (long)n, (int)f.decls.used, f.decls.data);
+  if (f.guard_count > 0) {
+    put(&functions, "  if (!veclisp_guards_hold((struct veclisp_guard *)data.as.pair[1].as.integer, %ld))\n", (long)f.guard_count);
+    put(&functions, "    return veclisp_lambda(parent, data.as.pair[0], args, result);\n");
+  }
+  put(&functions, "  veclisp_bind_args(b, N%ld, %ld, args);\n  scope.bindings = b;\n  scope.next = parent;\n", (long)id, (long)n);
+  put(&functions, "%.*s  *result = t;\n  return 0;\n}\n", (int)f.body.used, f.body.data);
+  put(&load, "  /* %s */\n", name.as.sym);
+  for (i = 0; i < n; ++i) put(&load, "  veclisp_rebind_local(N%ld[%ld]);\n", (long)id, (long)i);
+  put(&load, "  fun = veclisp_cons(veclisp_from_int((int64_t)compiled%ld), veclisp_cons(K[%ld], ", (long)id, (long)k);
+  if (f.guard_count > 0) put(&load, "veclisp_from_int((int64_t)veclisp_guard_natives(root, G%ld, F%ld, %ld))));\n", (long)id, (long)id, (long)f.guard_count);
+  else put(&load, "veclisp_nil()));\n");
+  i = constant(name);
+  put(&load, "  veclisp_rebind(K[%ld].as.sym);\n  veclisp_set(root, K[%ld].as.sym, fun);\n  *result = fun;\n", (long)i, (long)i);
+  free(f.decls.data);
+  free(f.body.data);
+}
+int read_file(const char *path) {
+  struct veclisp_cell form;
+  struct veclisp_scope scope;
+  struct veclisp_bindings in;
+  FILE *file;
+  if ((file = fopen(path, "r")) == NULL) {
+    perror(path);
+    return 1;
+  }
+  scope.bindings = &in;
+  scope.next = root;
+  in.sym = VECLISP_INPORT;
+  in.value = veclisp_from_int((int64_t)file);
+  in.next = NULL;
+  while (!veclisp_read(&scope, &form)) {
+    if (form.type == VECLISP_PAIR && form.as.pair != NULL && form.as.pair[0].type == VECLISP_SYM
+        && form.as.pair[0].as.sym == veclisp_intern("lexical")
+        && form.as.pair[1].type == VECLISP_PAIR && form.as.pair[1].as.pair == NULL) {
+      fprintf(stderr, "veclisp-compile: %s: lexical mode cannot be compiled\n", path);
+      return 1;
+    }
+    if (program.count == program.allocated) {
+      program.allocated = program.allocated ? program.allocated * 2 : 256;
+      program.forms = realloc(program.forms, sizeof(*program.forms) * program.allocated);
+      program.paths = realloc(program.paths, sizeof(*program.paths) * program.allocated);
+    }
+    program.forms[program.count] = form;
+    program.paths[program.count++] = path;
+    if (!definition_p(form)) continue;
+    if (defined.count == defined.allocated) {
+      defined.allocated = defined.allocated ? defined.allocated * 2 : 64;
+      defined.syms = realloc(defined.syms, sizeof(*defined.syms) * defined.allocated);
+      defined.ids = realloc(defined.ids, sizeof(*defined.ids) * defined.allocated);
+    }
+    defined.syms[defined.count] = form.as.pair[1].as.pair[0].as.pair[1].as.sym;
+    defined.ids[defined.count] = defined.count;
+    defined.count++;
+  }
+  fclose(file);
+  if (form.type != VECLISP_INT) {
+    fprintf(stderr, "veclisp-compile: %s: ", path);
+    veclisp_fwrite(stderr, form);
+    fputc('\n', stderr);
+    return 1;
+  }
+  return 0;
+}
+int main(int argc, char **argv) {
+  struct veclisp_interp *interp;
+  int64_t j;
+  int i;
+  if (argc < 2) {
+    fputs("usage: veclisp-compile file.l... > out.c\n", stderr);
+    return 2;
+  }
+  interp = veclisp_interp_new();
+  root = veclisp_interp_scope(interp);
+  for (i = 1; i < argc; ++i) {
+    if (read_file(argv[i])) return 1;
+  }
+  for (j = 0; j < program.count; ++j) {
+    if (j == 0 || program.paths[j] != program.paths[j - 1]) put(&load, "  /* %s */\n", program.paths[j]);
+    if (definition_p(program.forms[j])) compile_definition(program.forms[j]);
+    else put(&load, "  if (veclisp_eval(root, K[%ld], result)) return 1;\n", (long)constant(program.forms[j]));
+  }
+  printf("/* generated by veclisp-compile. do not edit. */\n"
+         "#include <pthread.h>\n"
+         "#include \"veclisp.h\"\n\n"
+         "static struct veclisp_cell K[%ld];\n"
+         "static pthread_once_t constants_once = PTHREAD_ONCE_INIT;\n", (long)(constant_count ? constant_count : 1));
+  fwrite(prototypes.data, 1, prototypes.used, stdout);
+  fwrite(functions.data, 1, functions.used, stdout);
+  printf("static void build_constants(void) {\n");
+  fwrite(constants.data, 1, constants.used, stdout);
+  printf("}\n"
+         "int veclisp_compiled(struct veclisp_scope *root, struct veclisp_cell *result) {\n");
+  if (function_count > 0) printf("  struct veclisp_cell fun;\n");
+  printf("  pthread_once(&constants_once, build_constants);\n"
+         "  *result = veclisp_nil();\n");
+  fwrite(load.data, 1, load.used, stdout);
+  printf("  return 0;\n}\n");
+  return 0;
+}
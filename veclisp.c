@@ -7,166 +7,479 @@
  * license: MIT                         *
  ****************************************/
 
+#define _GNU_SOURCE
 #include <ctype.h>
 #include <math.h>
 #include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <sched.h>
+#include <signal.h>
+#include <sys/epoll.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <ucontext.h>
+#include <unistd.h>
+#include <pthread.h>
+#define GC_THREADS
 #include <gc.h>
+#include <gc/gc_mark.h>
+#include "veclisp.h"
 
 #define TRACE(x)  fputs(x "\n", stderr)
 
-struct veclisp_cell {
+struct veclisp_lazy {
   enum
-    { VECLISP_INT,
-      VECLISP_SYM,
-      VECLISP_VEC,
-      VECLISP_PAIR,
-    } type;
-  union {
-    int64_t integer;
-    char *sym;
-    struct veclisp_cell *vec;
-    struct veclisp_cell *pair;
-  } as;
-};
-struct veclisp_scope {
-  struct veclisp_bindings {
-    char *sym;
-    struct veclisp_cell value;
-    struct veclisp_bindings *next;
-  } *bindings;
-  struct veclisp_scope *next;
+    { VECLISP_LAZY_FORCED,
+      VECLISP_LAZY_UNFOLD,
+      VECLISP_LAZY_MAP,
+      VECLISP_LAZY_FILTER,
+      VECLISP_LAZY_READ,
+      VECLISP_LAZY_RANGE,
+    } kind;
+  /* forced: () or (head . tail). otherwise seed holds the unfold seed,
+     the source sequence of a map or filter, the port to read from, or
+     the next integer of a range bounded by pred and advanced by step. */
+  struct veclisp_cell value, fun, pred, step, seed;
 };
 struct veclisp_interned_syms {
   char *sym;
+  uint64_t hash;
   struct veclisp_interned_syms *next;
-} *veclisp_interned_syms;
-typedef int (*veclisp_native_func)(struct veclisp_scope *, struct veclisp_cell, struct veclisp_cell *);
-
-char *VECLISP_UPVAL, *VECLISP_AT, *VECLISP_T, *VECLISP_OUTPORT, *VECLISP_INPORT, *VECLISP_ERRPORT, *VECLISP_PROMPT, *VECLISP_DEFAULT_PROMPT, *VECLISP_QUOTE, *VECLISP_UNQUOTE, *VECLISP_RESPONSE, *VECLISP_DEFAULT_RESPONSE, *VECLISP_ERR_ILLEGAL_DOTTED_LIST, *VECLISP_ERR_EXPECTED_CLOSE_PAREN, *VECLISP_ERR_CANNOT_EXEC_VEC, *VECLISP_ERR_INVALID_NAME, *VECLISP_ERR_EXPECTED_PAIR, *VECLISP_ERR_ILLEGAL_LAMBDA_LIST, *VECLISP_ERR_EXPECTED_INT, *VECLISP_ERR_INVALID_SEQUENCE;
-char *veclisp_intern(char *sym);
+};
+struct veclisp_intern_table {
+  pthread_mutex_t lock;
+  int64_t count, allocated;
+  struct veclisp_interned_syms **buckets;
+} veclisp_intern_table = { PTHREAD_MUTEX_INITIALIZER, 0, 0, NULL };
+struct veclisp_ptrmap {
+  int64_t used, allocated;
+  struct veclisp_ptrmap_entry {
+    void *key;
+    void *value;
+  } *entries;
+  /* a weak map hides its keys from the collector, which empties an
+     entry's key when the object it names is collected */
+  int weak;
+};
+struct veclisp_qq {
+  enum
+    { VECLISP_QQ_CONST,
+      VECLISP_QQ_HOLE,
+      VECLISP_QQ_PAIR,
+      VECLISP_QQ_VEC,
+    } kind;
+  struct veclisp_cell value;
+  struct veclisp_qq *head, *tail, **elems;
+};
+/* bindings a lambda or let frame keeps on the C stack; larger frames
+   take one heap block */
+#define VECLISP_FRAME_SLOTS 8
+/* call sites whose global head binding an interpreter remembers */
+#define VECLISP_CALL_CACHE 4096
+/* quasiquote templates an interpreter keeps the plans of */
+#define VECLISP_QQ_PLANS 256
+#define VECLISP_JIT_COUNTS 1024
+typedef int (*veclisp_jit_func)(struct veclisp_scope *scope, struct veclisp_bindings *bindings, struct veclisp_cell *result);
+/* what the jit knows of a lambda that reached the threshold: its code,
+   unmapped once the lambda is collected, the global bindings of the
+   natives that code inlined, and the write count of the form the lambda
+   was read in when it was compiled */
+#define VECLISP_JIT_GUARDS 10
+struct veclisp_literal;
+struct veclisp_jit {
+  int64_t rejected, guard_count, size, writes;
+  veclisp_jit_func code;
+  struct veclisp_guard guards[VECLISP_JIT_GUARDS];
+  struct veclisp_literal *literal;
+};
+#define VECLISP_COROUTINE_STACK (256 * 1024)
+/* a coroutine is linked into at most one list at a time: the run queue,
+   or the waiters of the channel it is blocked on. its stack is mapped
+   below an inaccessible guard page, so overflowing it faults instead of
+   running into the heap. the collector scans the stack through the
+   coroutine, from sp while it is suspended, together with the part of
+   the stack it was resumed from, from caller_sp to caller_base, while
+   it runs. */
+struct veclisp_coroutine {
+  ucontext_t context;
+  void *stack, *sp, *caller_sp, *caller_base;
+  int done;
+  struct veclisp_cell fun, args;
+  struct veclisp_scope *scope;
+  struct veclisp_coroutine *next;
+};
+struct veclisp_scheduler {
+  ucontext_t context;
+  struct GC_stack_base stack_base;
+  struct veclisp_coroutine *current, *head, *tail;
+  int64_t alive, io_waiting, spawned, queued, stalled;
+};
+/* a bounded MPMC ring after Vyukov: each slot carries a sequence number
+   telling producers and consumers whose turn it is, so neither side
+   takes a lock. the two cursors sit on separate cache lines. */
+struct veclisp_chan {
+  int64_t mask;
+  int closed;
+  struct veclisp_chan_slot {
+    int64_t seq;
+    struct veclisp_cell value;
+  } *slots;
+  char pad0[64];
+  int64_t enqueue_pos;
+  char pad1[64];
+  int64_t dequeue_pos;
+  char pad2[64];
+};
+/* frozen graphs are copied into chunks that are never mutated, so any
+   thread can read them, and that are collected once nothing points into
+   them. a pointer is frozen iff it falls inside a live chunk. the live
+   chunks are kept sorted in a table that is replaced rather than
+   changed, so looking one up takes no lock; the table is allocated
+   atomic, so it keeps no chunk alive. the lock is recursive because a
+   chunk's finalizer can run inside an allocation made under it. */
+#define VECLISP_FROZEN_CHUNK (1024 * 1024)
+#define VECLISP_FROZEN_MAX_CHUNKS 4096
+struct veclisp_frozen_table {
+  int64_t count;
+  struct veclisp_frozen_chunk {
+    char *start, *end;
+  } chunks[];
+};
+struct veclisp_frozen {
+  pthread_mutex_t lock;
+  char *next, *end;
+  struct veclisp_frozen_table *table;
+} veclisp_frozen = { PTHREAD_RECURSIVE_MUTEX_INITIALIZER_NP };
+/* a memoized function is the pair (closure . memo), called like a
+   lambda with evaluated arguments. entries are chained by hash for
+   lookup and doubly linked from newest to oldest for eviction. */
+struct veclisp_memo {
+  struct veclisp_cell fun;
+  int64_t count, limit, allocated, hits, misses, evictions;
+  struct veclisp_memo_entry {
+    uint64_t hash;
+    struct veclisp_cell key, value;
+    struct veclisp_memo_entry *next, *newer, *older;
+  } **buckets, *newest, *oldest;
+};
+/* the slots of one lexical frame, found through the marker binding its
+   closure or let pushes. a frame a nested closure can capture lives on
+   the heap, any other on the C stack. */
+struct veclisp_lexenv {
+  struct veclisp_lexenv *up;
+  struct veclisp_cell *slots;
+};
+/* an enclosing lexical frame while compiling */
+struct veclisp_lexlevel {
+  struct veclisp_cell names;
+  int captured;
+  struct veclisp_lexlevel *up;
+};
+struct veclisp_watch {
+  struct veclisp_cell on_read, on_write;
+  uint32_t registered, waiting, ready;
+  struct veclisp_coroutine *reader, *writer;
+};
+struct veclisp_event_loop {
+  int epoll_fd;
+  int64_t watch_count, allocated;
+  struct veclisp_watch *watches;
+  struct veclisp_scope *scope;
+};
+struct veclisp_pipe {
+  struct veclisp_pipe_stage {
+    enum
+      { VECLISP_STAGE_MAP,
+        VECLISP_STAGE_FILTER,
+        VECLISP_STAGE_TAKE,
+        VECLISP_STAGE_DROP,
+        VECLISP_STAGE_FOLD,
+      } kind;
+    struct veclisp_cell fun;
+    int64_t n;
+  } *stages;
+  int64_t stage_count, used, allocated;
+  int done, folding;
+  struct veclisp_cell acc, *tail;
+};
+/* everything an interpreter mutates lives here, so interpreters on
+   different threads never share state. symbols are the exception: the
+   intern table is shared and locked. */
+struct veclisp_interp {
+  struct veclisp_scope root;
+  struct veclisp_ptrmap jit_entries;
+  /* direct-mapped by template. a plan holds its template, so the table
+     pins at most VECLISP_QQ_PLANS of them; a plan is made again after a
+     write into the form its template was read in */
+  struct veclisp_qq_plan {
+    void *key;
+    struct veclisp_qq *plan;
+    int64_t writes;
+  } qq_plans[VECLISP_QQ_PLANS];
+  /* direct-mapped by call form. an entry holds while the interpreter's
+     global version is unchanged, the site still has the same head
+     and no local binding of the head symbol has ever been made */
+  struct veclisp_call_cache {
+    struct veclisp_cell *site;
+    char *sym;
+    struct veclisp_bindings *binding;
+    int64_t version;
+  } call_cache[VECLISP_CALL_CACHE];
+  int64_t global_version, call_cache_hits, call_cache_misses;
+  /* lambdas run compiled after this many calls; zero leaves them all
+     to the interpreter */
+  int64_t jit_threshold, jit_compiled, jit_rejected, jit_deopts;
+  /* calls of lambdas not yet compiled, direct-mapped by hidden address
+     so that counting keeps nothing alive. a collision only restarts a
+     count. */
+  struct veclisp_jit_count {
+    GC_hidden_pointer lambda;
+    int64_t calls;
+  } jit_counts[VECLISP_JIT_COUNTS];
+  /* xoshiro256** state, seeded on first use */
+  uint64_t rand_state[4];
+  int rand_seeded;
+  struct veclisp_event_loop event_loop;
+  struct veclisp_scheduler scheduler;
+};
+/* one thread's share of read-all-parallel, which gives no thread
+   less than VECLISP_READ_PIECE_MIN bytes */
+#define VECLISP_READ_PIECE_MIN (256 * 1024)
+/* a piece of a mapped file; bytes keeps the mapping alive while the
+   piece is read */
+struct veclisp_read_chunk {
+  pthread_t thread;
+  int started, failed;
+  struct veclisp_bytes *bytes;
+  const unsigned char *data;
+  int64_t length, count;
+  struct veclisp_cell *forms, err;
+};
+struct veclisp_isolate {
+  pthread_t thread;
+  int failed, joined;
+  struct veclisp_cell form, result;
+};
+/* every isolate started and not yet collected, so join-isolate only
+   ever trusts a handle that names one */
+pthread_mutex_t veclisp_isolates_lock = PTHREAD_MUTEX_INITIALIZER;
+struct veclisp_ptrmap veclisp_isolates = { 0, 0, NULL, 1 };
+__thread struct veclisp_interp *veclisp_current;
+/* isolates count from the moment they are requested, so a channel user
+   never mistakes a thread that is still starting for a deadlock */
+int64_t veclisp_interp_count, veclisp_isolates_starting;
+int64_t veclisp_fold_epoch;
+/* a form read at the top level. every pair and vector the reader makes
+   for it carries one hidden cell past its end pointing here, so a write
+   into any of them can be told apart from writes to other storage. */
+struct veclisp_literal {
+  int64_t writes;
+};
+/* the type of that hidden cell, which no value ever has */
+#define VECLISP_LITERAL 64
+__thread struct veclisp_literal *veclisp_reading;
+/* allocation kind of coroutines, marked by veclisp_mark_coroutine */
+unsigned veclisp_coroutine_kind;
+pthread_once_t veclisp_syms_once = PTHREAD_ONCE_INIT;
+char *VECLISP_UPVAL, *VECLISP_AT, *VECLISP_T, *VECLISP_OUTPORT, *VECLISP_INPORT, *VECLISP_ERRPORT, *VECLISP_PROMPT, *VECLISP_DEFAULT_PROMPT, *VECLISP_QUOTE, *VECLISP_QUASIQUOTE, *VECLISP_UNQUOTE, *VECLISP_MAP, *VECLISP_FILTER, *VECLISP_TAKE, *VECLISP_DROP, *VECLISP_FOLD, *VECLISP_ERR_INVALID_STAGE, *VECLISP_ERR_INVALID_STEP, *VECLISP_ERR_EXPECTED_BYTES, *VECLISP_ERR_READ_ONLY, *VECLISP_ERR_OUT_OF_RANGE, *VECLISP_AGAIN, *VECLISP_ERR_EXPECTED_CHAN, *VECLISP_ERR_CHAN_CLOSED, *VECLISP_ERR_DEADLOCK, *VECLISP_ERR_CANNOT_FREEZE, *VECLISP_ERR_FROZEN_FULL, *VECLISP_ERR_EXPECTED_MEMO, *VECLISP_ERR_EXPECTED_ISOLATE, *VECLISP_ERR_ISOLATE_JOINED, *VECLISP_ERR_EXPECTED_VEC, *VECLISP_ERR_EXPECTED_GROWABLE, *VECLISP_RESPONSE, *VECLISP_LEXICAL, *VECLISP_DEFAULT_RESPONSE, *VECLISP_ERR_ILLEGAL_DOTTED_LIST, *VECLISP_ERR_EXPECTED_CLOSE_PAREN, *VECLISP_ERR_CANNOT_EXEC_VEC, *VECLISP_ERR_INVALID_NAME, *VECLISP_ERR_EXPECTED_PAIR, *VECLISP_ERR_ILLEGAL_LAMBDA_LIST, *VECLISP_ERR_EXPECTED_INT, *VECLISP_ERR_INVALID_SEQUENCE;
 void veclisp_print_prompt(struct veclisp_scope *scope);
 void veclisp_write_result(struct veclisp_scope *scope, struct veclisp_cell value);
-void veclisp_print_err(struct veclisp_scope *scope, struct veclisp_cell err);
-int veclisp_init_root_scope(struct veclisp_scope *root_scope);
-int veclisp_scope_lookup(struct veclisp_scope *scope, char *sym, struct veclisp_cell *result);
-int veclisp_read(struct veclisp_scope *scope, struct veclisp_cell *result);
-int veclisp_eval(struct veclisp_scope *scope, struct veclisp_cell value, struct veclisp_cell *result);
-int veclisp_n_begin(struct veclisp_scope *, struct veclisp_cell, struct veclisp_cell *);
-int veclisp_lambda(struct veclisp_scope *parent_scope, struct veclisp_cell lambda, struct veclisp_cell args, struct veclisp_cell *result);
-int veclisp_n_call(struct veclisp_scope *scope, struct veclisp_cell args, struct veclisp_cell *result);
-void veclisp_write(struct veclisp_scope *scope, struct veclisp_cell value);
-void veclisp_set(struct veclisp_scope *scope, char *interned_sym, struct veclisp_cell value);
-void veclisp_fwrite(FILE *out, struct veclisp_cell value);
-int veclisp_n_quote(struct veclisp_scope *, struct veclisp_cell, struct veclisp_cell *);
-int veclisp_n_intp(struct veclisp_scope *, struct veclisp_cell, struct veclisp_cell *);
-int veclisp_n_symp(struct veclisp_scope *, struct veclisp_cell, struct veclisp_cell *);
-int veclisp_n_vecp(struct veclisp_scope *, struct veclisp_cell, struct veclisp_cell *);
-int veclisp_n_pairp(struct veclisp_scope *, struct veclisp_cell, struct veclisp_cell *);
-int veclisp_n_nilp(struct veclisp_scope *, struct veclisp_cell, struct veclisp_cell *);
-int veclisp_n_pair(struct veclisp_scope *, struct veclisp_cell, struct veclisp_cell *);
-int veclisp_n_head(struct veclisp_scope *, struct veclisp_cell, struct veclisp_cell *);
-int veclisp_n_tail(struct veclisp_scope *, struct veclisp_cell, struct veclisp_cell *);
-int veclisp_n_cmp(struct veclisp_scope *, struct veclisp_cell, struct veclisp_cell *);
-int veclisp_n_eq(struct veclisp_scope *, struct veclisp_cell, struct veclisp_cell *);
-int veclisp_n_gt(struct veclisp_scope *, struct veclisp_cell, struct veclisp_cell *);
-int veclisp_n_lt(struct veclisp_scope *, struct veclisp_cell, struct veclisp_cell *);
-int veclisp_n_gte(struct veclisp_scope *, struct veclisp_cell, struct veclisp_cell *);
-int veclisp_n_lte(struct veclisp_scope *, struct veclisp_cell, struct veclisp_cell *);
-int veclisp_n_set(struct veclisp_scope *, struct veclisp_cell, struct veclisp_cell *);
-int veclisp_n_syms(struct veclisp_scope *, struct veclisp_cell, struct veclisp_cell *);
-int veclisp_n_add(struct veclisp_scope *, struct veclisp_cell, struct veclisp_cell *);
-int veclisp_n_sub(struct veclisp_scope *, struct veclisp_cell, struct veclisp_cell *);
-int veclisp_n_mul(struct veclisp_scope *, struct veclisp_cell, struct veclisp_cell *);
-int veclisp_n_div(struct veclisp_scope *, struct veclisp_cell, struct veclisp_cell *);
-int veclisp_n_mod(struct veclisp_scope *, struct veclisp_cell, struct veclisp_cell *);
-int veclisp_n_exp(struct veclisp_scope *, struct veclisp_cell, struct veclisp_cell *);
-int veclisp_n_rsh(struct veclisp_scope *, struct veclisp_cell, struct veclisp_cell *);
-int veclisp_n_lsh(struct veclisp_scope *, struct veclisp_cell, struct veclisp_cell *);
-int veclisp_n_bitwiseand(struct veclisp_scope *, struct veclisp_cell, struct veclisp_cell *);
-int veclisp_n_bitwiseor(struct veclisp_scope *, struct veclisp_cell, struct veclisp_cell *);
-int veclisp_n_bitwisexor(struct veclisp_scope *, struct veclisp_cell, struct veclisp_cell *);
-int veclisp_n_bitwisenot(struct veclisp_scope *, struct veclisp_cell, struct veclisp_cell *);
-int veclisp_n_abs(struct veclisp_scope *, struct veclisp_cell, struct veclisp_cell *);
-int veclisp_n_sqrt(struct veclisp_scope *, struct veclisp_cell, struct veclisp_cell *);
-int veclisp_n_rand(struct veclisp_scope *, struct veclisp_cell, struct veclisp_cell *);
-int veclisp_n_and(struct veclisp_scope *, struct veclisp_cell, struct veclisp_cell *);
-int veclisp_n_or(struct veclisp_scope *, struct veclisp_cell, struct veclisp_cell *);
-int veclisp_n_max(struct veclisp_scope *, struct veclisp_cell, struct veclisp_cell *);
-int veclisp_n_min(struct veclisp_scope *, struct veclisp_cell, struct veclisp_cell *);
-int veclisp_n_vectorref(struct veclisp_scope *, struct veclisp_cell, struct veclisp_cell *);
-int veclisp_n_vectorset(struct veclisp_scope *, struct veclisp_cell, struct veclisp_cell *);
-int veclisp_n_length(struct veclisp_scope *, struct veclisp_cell, struct veclisp_cell *);
-int veclisp_n_eval(struct veclisp_scope *, struct veclisp_cell, struct veclisp_cell *);
-int veclisp_n_sethead(struct veclisp_scope *, struct veclisp_cell, struct veclisp_cell *);
-int veclisp_n_settail(struct veclisp_scope *, struct veclisp_cell, struct veclisp_cell *);
-int veclisp_n_locals(struct veclisp_scope *, struct veclisp_cell, struct veclisp_cell *);
-int veclisp_n_globals(struct veclisp_scope *, struct veclisp_cell, struct veclisp_cell *);
-int veclisp_n_list(struct veclisp_scope *, struct veclisp_cell, struct veclisp_cell *);
-int veclisp_n_load(struct veclisp_scope *, struct veclisp_cell, struct veclisp_cell *);
-int veclisp_n_macro(struct veclisp_scope *, struct veclisp_cell, struct veclisp_cell *);
-int veclisp_n_open(struct veclisp_scope *, struct veclisp_cell, struct veclisp_cell *);
-int veclisp_n_close(struct veclisp_scope *, struct veclisp_cell, struct veclisp_cell *);
-int veclisp_n_map(struct veclisp_scope *, struct veclisp_cell, struct veclisp_cell *);
-int veclisp_n_filter(struct veclisp_scope *, struct veclisp_cell, struct veclisp_cell *);
-int veclisp_n_let(struct veclisp_scope *, struct veclisp_cell, struct veclisp_cell *);
-int veclisp_n_read(struct veclisp_scope *, struct veclisp_cell, struct veclisp_cell *);
-int veclisp_n_throw(struct veclisp_scope *, struct veclisp_cell, struct veclisp_cell *);
-int veclisp_n_catch(struct veclisp_scope *, struct veclisp_cell, struct veclisp_cell *);
-int veclisp_n_writebytes(struct veclisp_scope *, struct veclisp_cell, struct veclisp_cell *);
-int veclisp_n_print(struct veclisp_scope *, struct veclisp_cell, struct veclisp_cell *);
-int veclisp_n_exit(struct veclisp_scope *, struct veclisp_cell, struct veclisp_cell *);
-int veclisp_n_write(struct veclisp_scope *, struct veclisp_cell, struct veclisp_cell *);
-int veclisp_n_pack(struct veclisp_scope *, struct veclisp_cell, struct veclisp_cell *);
-int veclisp_n_fold(struct veclisp_scope *, struct veclisp_cell, struct veclisp_cell *);
-int veclisp_n_no(struct veclisp_scope *, struct veclisp_cell, struct veclisp_cell *);
-int veclisp_n_yes(struct veclisp_scope *, struct veclisp_cell, struct veclisp_cell *);
-int veclisp_n_unfoldpair(struct veclisp_scope *, struct veclisp_cell, struct veclisp_cell *);
-int veclisp_n_unfoldvec(struct veclisp_scope *, struct veclisp_cell, struct veclisp_cell *);
-int veclisp_n_find(struct veclisp_scope *, struct veclisp_cell, struct veclisp_cell *);
-int veclisp_n_if(struct veclisp_scope *, struct veclisp_cell, struct veclisp_cell *);
-#define FORNEXT(var, init) for (var = init; var != NULL; var = var->next)
-#define FORPAIR(var, init) for (var = init; var->type == VECLISP_PAIR && var->as.pair != NULL; var = &var->as.pair[1])
-#define FORVEC(i, vec) for (i = 1; i <= vec[0].as.integer; ++i)
+void *veclisp_ptrmap_get(struct veclisp_ptrmap *map, void *key);
+void veclisp_ptrmap_put(struct veclisp_ptrmap *map, void *key, void *value);
+veclisp_jit_func veclisp_jit_entry(struct veclisp_cell lambda);
+int veclisp_lex_define(struct veclisp_cell *form, struct veclisp_cell *result);
+int veclisp_n_lexref(struct veclisp_scope *scope, struct veclisp_cell args, struct veclisp_cell *result);
+int veclisp_lazy_map(int kind, struct veclisp_cell fun, struct veclisp_cell source, struct veclisp_cell *result);
+int veclisp_range_bounds(struct veclisp_cell seq, int64_t *start, int64_t *end, int64_t *step);
+int veclisp_frozen_p(void *p);
+int veclisp_errno_err(struct veclisp_cell *result);
+int veclisp_load_stream(struct veclisp_scope *scope, FILE *in, int echo, struct veclisp_cell *result);
+void veclisp_wake(struct veclisp_coroutine **waiters);
+void veclisp_suspend(struct veclisp_coroutine *co);
+struct GC_ms_entry *veclisp_mark_coroutine(GC_word *addr, struct GC_ms_entry *msp, struct GC_ms_entry *lim, GC_word env);
+int veclisp_runnable(void);
+int veclisp_step(struct veclisp_scope *scope, int timeout, int64_t *count, struct veclisp_cell *result);
 
-int main() {
-  struct veclisp_scope root_scope;
+#ifndef VECLISP_NO_MAIN
+void veclisp_usage(void) {
+  fputs("usage: veclisp [-q] [-l file]... [-e expr]... [script | -]...\n"
+        "       veclisp [-l file]... -s socket [-w workers] [-r max-requests]\n", stderr);
+  exit(2);
+}
+/* runs one script or -e expression. batch input stops at its first
+   error, which main turns into a failing exit status. */
+int veclisp_batch(struct veclisp_interp *interp, FILE *in, int quiet) {
+  struct veclisp_cell result;
+  if (in == NULL) {
+    veclisp_errno_err(&result);
+    veclisp_print_err(&interp->root, result);
+    return 1;
+  }
+  if (veclisp_load_stream(&interp->root, in, !quiet, &result)) {
+    fflush(stdout);
+    veclisp_print_err(&interp->root, result);
+    return 1;
+  }
+  return 0;
+}
+int main(int argc, char **argv) {
+  struct veclisp_interp *interp;
+  struct veclisp_scope *root_scope;
   struct veclisp_cell last_read, last_eval_result;
-  veclisp_init_root_scope(&root_scope);
+  char *socket_path = NULL, **actions;
+  int opt, workers = 4, quiet = 0, batch = 0, failed, i, count = 0;
+  int64_t max_requests = 1000;
+  FILE *in;
+  GC_set_handle_fork(1);
+  GC_INIT();
+  interp = veclisp_interp_new();
+  root_scope = &interp->root;
+  /* -l and -e run in order once every option is known, so a -q after
+     them still applies. each is kept as its option letter and argument. */
+  actions = malloc(sizeof(*actions) * 2 * argc);
+  while ((opt = getopt(argc, argv, "l:e:qs:w:r:")) != -1) {
+    switch (opt) {
+    case 'l':
+    case 'e':
+      actions[count++] = opt == 'l' ? "l" : "e";
+      actions[count++] = optarg;
+      if (opt == 'e') batch = 1;
+      break;
+    case 'q':
+      quiet = 1;
+      /* nobody is watching, so trade prompt latency for fewer writes */
+      setvbuf(stdout, NULL, _IOFBF, 1 << 16);
+      break;
+    case 's': socket_path = optarg; break;
+    case 'w': if ((workers = atoi(optarg)) < 1) veclisp_usage(); break;
+    case 'r': if ((max_requests = atoll(optarg)) < 0) veclisp_usage(); break;
+    default: veclisp_usage();
+    }
+  }
+  for (i = 0; i < count; i += 2) {
+    if (*actions[i] == 'l') {
+      if (veclisp_load_file(interp, actions[i + 1], &last_eval_result)) {
+        veclisp_print_err(root_scope, last_eval_result);
+        return 1;
+      }
+      continue;
+    }
+    in = fmemopen(actions[i + 1], strlen(actions[i + 1]), "r");
+    failed = veclisp_batch(interp, in, quiet);
+    if (in != NULL) fclose(in);
+    if (failed) return 1;
+  }
+  free(actions);
+  if (socket_path != NULL) {
+    if (optind != argc || batch) veclisp_usage();
+    if (veclisp_serve(interp, socket_path, workers, max_requests)) {
+      perror(socket_path);
+      return 1;
+    }
+    return 0;
+  }
+  for (; optind < argc; ++optind) {
+    batch = 1;
+    if (!strcmp(argv[optind], "-")) failed = veclisp_batch(interp, stdin, quiet);
+    else {
+      in = fopen(argv[optind], "r");
+      failed = veclisp_batch(interp, in, quiet);
+      if (in != NULL) fclose(in);
+    }
+    if (failed) return 1;
+  }
+  if (batch) return 0;
+  if (quiet) return veclisp_batch(interp, stdin, quiet);
   for (;;) {
-    veclisp_print_prompt(&root_scope);
-    if (veclisp_read(&root_scope, &last_read)) {
+    veclisp_print_prompt(root_scope);
+    if (veclisp_read(root_scope, &last_read)) {
       if (last_read.type == VECLISP_INT && last_read.as.integer == EOF) break;
-      veclisp_print_err(&root_scope, last_read);
-    } else if (veclisp_eval(&root_scope, last_read, &last_eval_result)) {
-      veclisp_print_err(&root_scope, last_eval_result);
+      veclisp_print_err(root_scope, last_read);
+    } else if (veclisp_eval(root_scope, last_read, &last_eval_result)) {
+      veclisp_print_err(root_scope, last_eval_result);
     } else {
-      veclisp_write_result(&root_scope, last_eval_result);
+      veclisp_write_result(root_scope, last_eval_result);
     }
   }
+  return 0;
 }
+#endif
 
-char *veclisp_intern(char *sym) {
-  struct veclisp_interned_syms *s;
-  if (veclisp_interned_syms == NULL) {
-    veclisp_interned_syms = malloc(sizeof(*veclisp_interned_syms));
-    veclisp_interned_syms->sym = sym;
-    veclisp_interned_syms->next = NULL;
-    return sym;
+uint64_t veclisp_hash_sym(const char *sym) {
+  uint64_t hash = 14695981039346656037ULL;
+  for (; *sym; ++sym) hash = (hash ^ (unsigned char)*sym) * 1099511628211ULL;
+  return hash;
+}
+/* the name is copied the first time it is seen, so callers keep
+   ownership of what they pass in. the byte before it holds the
+   symbol's VECLISP_SYM_* flags. */
+char *veclisp_intern(const char *sym) {
+  int64_t i, allocated;
+  uint64_t hash = veclisp_hash_sym(sym);
+  struct veclisp_interned_syms *s, *next, **buckets;
+  pthread_mutex_lock(&veclisp_intern_table.lock);
+  if (veclisp_intern_table.count >= veclisp_intern_table.allocated) {
+    allocated = veclisp_intern_table.allocated ? veclisp_intern_table.allocated * 2 : 1024;
+    buckets = calloc(allocated, sizeof(*buckets));
+    for (i = 0; i < veclisp_intern_table.allocated; ++i) {
+      for (s = veclisp_intern_table.buckets[i]; s != NULL; s = next) {
+        next = s->next;
+        s->next = buckets[s->hash & (allocated - 1)];
+        buckets[s->hash & (allocated - 1)] = s;
+      }
+    }
+    free(veclisp_intern_table.buckets);
+    veclisp_intern_table.buckets = buckets;
+    veclisp_intern_table.allocated = allocated;
   }
-  FORNEXT(s, veclisp_interned_syms) {
-    if (!strcmp(sym, s->sym)) {
-      free(sym);
+  FORNEXT(s, veclisp_intern_table.buckets[hash & (veclisp_intern_table.allocated - 1)]) {
+    if (s->hash == hash && !strcmp(sym, s->sym)) {
+      pthread_mutex_unlock(&veclisp_intern_table.lock);
       return s->sym;
     }
   }
   s = malloc(sizeof(*s));
-  s->next = veclisp_interned_syms;
-  s->sym = sym;
-  veclisp_interned_syms = s;
-  return sym;
+  s->sym = malloc(strlen(sym) + 2);
+  *s->sym++ = 0;
+  strcpy(s->sym, sym);
+  s->hash = hash;
+  s->next = veclisp_intern_table.buckets[hash & (veclisp_intern_table.allocated - 1)];
+  veclisp_intern_table.buckets[hash & (veclisp_intern_table.allocated - 1)] = s;
+  veclisp_intern_table.count++;
+  pthread_mutex_unlock(&veclisp_intern_table.lock);
+  return s->sym;
+}
+/* called wherever a symbol gets a binding other than its global one.
+   the first time that happens to a symbol some folded code relied on,
+   every optimized function falls back to its original body. */
+/* symbols are shared by every thread, so their flags are only ever set
+   with an atomic or. returns the flags from before. */
+unsigned char veclisp_sym_flag(char *sym, unsigned char flag) {
+  unsigned char *flags = (unsigned char *)sym - 1;
+  if ((__atomic_load_n(flags, __ATOMIC_RELAXED) & flag) == flag) return *flags;
+  return __atomic_fetch_or(flags, flag, __ATOMIC_SEQ_CST);
+}
+/* whichever of rebinding and folding flags the symbol second sees the
+   other's flag, so one of them always moves the epoch on */
+void veclisp_rebind(char *sym) {
+  unsigned char before = veclisp_sym_flag(sym, VECLISP_SYM_REBOUND);
+  if (!(before & VECLISP_SYM_REBOUND) && (before & VECLISP_SYM_FOLDED))
+    __atomic_add_fetch(&veclisp_fold_epoch, 1, __ATOMIC_RELAXED);
+}
+/* as veclisp_rebind, for a binding in a local frame. a call site whose
+   head symbol was ever bound locally no longer trusts its cache. */
+void veclisp_rebind_local(char *sym) {
+  veclisp_sym_flag(sym, VECLISP_SYM_SHADOWED);
+  veclisp_rebind(sym);
 }
 void veclisp_print_prompt(struct veclisp_scope *scope) {
   struct veclisp_cell out, prompt;
@@ -212,8 +525,13 @@ void veclisp_print_err(struct veclisp_scope *scope, struct veclisp_cell err) {
   veclisp_fwrite((FILE *)errport.as.integer, err);
   fputc('\n', (FILE *)errport.as.integer);
 }
-int veclisp_init_root_scope(struct veclisp_scope *root_scope) {
-  struct veclisp_cell value;
+void veclisp_init_syms(void) {
+  /* a peer closing its end makes writes fail with EPIPE instead of
+     killing the interpreter */
+  signal(SIGPIPE, SIG_IGN);
+  /* lets hosts attach threads of their own */
+  GC_allow_register_threads();
+  veclisp_coroutine_kind = GC_new_kind(GC_new_free_list(), GC_MAKE_PROC(GC_new_proc(veclisp_mark_coroutine), 0), 0, 1);
   VECLISP_UPVAL = veclisp_intern("upval");
   VECLISP_AT = veclisp_intern("@");
   VECLISP_T = veclisp_intern("t");
@@ -223,8 +541,15 @@ int veclisp_init_root_scope(struct veclisp_scope *root_scope) {
   VECLISP_PROMPT = veclisp_intern("*Prompt");
   VECLISP_DEFAULT_PROMPT = veclisp_intern("> ");
   VECLISP_QUOTE = veclisp_intern("quote");
+  VECLISP_QUASIQUOTE = veclisp_intern("quasiquote");
   VECLISP_UNQUOTE = veclisp_intern("unquote");
+  VECLISP_MAP = veclisp_intern("map");
+  VECLISP_FILTER = veclisp_intern("filter");
+  VECLISP_TAKE = veclisp_intern("take");
+  VECLISP_DROP = veclisp_intern("drop");
+  VECLISP_FOLD = veclisp_intern("fold");
   VECLISP_RESPONSE = veclisp_intern("*Response");
+  VECLISP_LEXICAL = veclisp_intern("*Lexical");
   VECLISP_DEFAULT_RESPONSE = veclisp_intern("; ");
   VECLISP_ERR_ILLEGAL_DOTTED_LIST = veclisp_intern("illegal dotted list");
   VECLISP_ERR_EXPECTED_CLOSE_PAREN = veclisp_intern("expected closing parentheses");
@@ -234,6 +559,55 @@ int veclisp_init_root_scope(struct veclisp_scope *root_scope) {
   VECLISP_ERR_ILLEGAL_LAMBDA_LIST = veclisp_intern("illegal lambda list");
   VECLISP_ERR_EXPECTED_INT = veclisp_intern("expected an integer");
   VECLISP_ERR_INVALID_SEQUENCE = veclisp_intern("invalid sequence. expected a vector or pair");
+  VECLISP_ERR_EXPECTED_BYTES = veclisp_intern("expected a byte vector");
+  VECLISP_AGAIN = veclisp_intern("again");
+  VECLISP_ERR_EXPECTED_CHAN = veclisp_intern("expected a channel");
+  VECLISP_ERR_CHAN_CLOSED = veclisp_intern("channel is closed");
+  VECLISP_ERR_DEADLOCK = veclisp_intern("channel operation can never complete");
+  VECLISP_ERR_CANNOT_FREEZE = veclisp_intern("cannot freeze a lazy sequence");
+  VECLISP_ERR_FROZEN_FULL = veclisp_intern("out of frozen memory");
+  VECLISP_ERR_EXPECTED_MEMO = veclisp_intern("expected a memoized function");
+  VECLISP_ERR_EXPECTED_ISOLATE = veclisp_intern("expected an isolate");
+  VECLISP_ERR_ISOLATE_JOINED = veclisp_intern("isolate already joined");
+  VECLISP_ERR_EXPECTED_VEC = veclisp_intern("expected a vector");
+  VECLISP_ERR_EXPECTED_GROWABLE = veclisp_intern("expected a growable vector");
+  VECLISP_ERR_READ_ONLY = veclisp_intern("cannot modify a read-only value");
+  VECLISP_ERR_OUT_OF_RANGE = veclisp_intern("index out of range");
+  VECLISP_ERR_INVALID_STEP = veclisp_intern("invalid range step. expected a non-zero integer");
+  VECLISP_ERR_INVALID_STAGE = veclisp_intern("invalid pipe stage. expected map, filter, take, drop or fold");
+  ((unsigned char *)VECLISP_INPORT)[-1] |= VECLISP_SYM_SPECIAL;
+  ((unsigned char *)VECLISP_OUTPORT)[-1] |= VECLISP_SYM_SPECIAL;
+  ((unsigned char *)VECLISP_ERRPORT)[-1] |= VECLISP_SYM_SPECIAL;
+  ((unsigned char *)VECLISP_PROMPT)[-1] |= VECLISP_SYM_SPECIAL;
+  ((unsigned char *)VECLISP_RESPONSE)[-1] |= VECLISP_SYM_SPECIAL;
+  ((unsigned char *)VECLISP_LEXICAL)[-1] |= VECLISP_SYM_SPECIAL;
+  ((unsigned char *)VECLISP_AT)[-1] |= VECLISP_SYM_SPECIAL;
+  ((unsigned char *)VECLISP_UPVAL)[-1] |= VECLISP_SYM_SPECIAL;
+  /* bound by the frames of if, while, begin, load and sessions */
+  ((unsigned char *)VECLISP_INPORT)[-1] |= VECLISP_SYM_SHADOWED;
+  ((unsigned char *)VECLISP_OUTPORT)[-1] |= VECLISP_SYM_SHADOWED;
+  ((unsigned char *)VECLISP_ERRPORT)[-1] |= VECLISP_SYM_SHADOWED;
+  ((unsigned char *)VECLISP_LEXICAL)[-1] |= VECLISP_SYM_SHADOWED;
+  ((unsigned char *)VECLISP_AT)[-1] |= VECLISP_SYM_SHADOWED;
+  ((unsigned char *)VECLISP_UPVAL)[-1] |= VECLISP_SYM_SHADOWED;
+}
+struct veclisp_interp *veclisp_interp_new(void) {
+  struct veclisp_interp *interp = GC_malloc_uncollectable(sizeof(*interp));
+  interp->jit_entries.weak = 1;
+  pthread_once(&veclisp_syms_once, veclisp_init_syms);
+  __atomic_add_fetch(&veclisp_interp_count, 1, __ATOMIC_RELAXED);
+  veclisp_current = interp;
+  veclisp_init_root_scope(&interp->root);
+  return interp;
+}
+void veclisp_interp_free(struct veclisp_interp *interp) {
+  if (interp->event_loop.watches != NULL) close(interp->event_loop.epoll_fd);
+  if (veclisp_current == interp) veclisp_current = NULL;
+  __atomic_sub_fetch(&veclisp_interp_count, 1, __ATOMIC_RELAXED);
+  GC_free(interp);
+}
+int veclisp_init_root_scope(struct veclisp_scope *root_scope) {
+  struct veclisp_cell value;
   root_scope->bindings = NULL;
   value.type = VECLISP_INT;
   value.as.integer = (int64_t)stdout;
@@ -244,6 +618,8 @@ int veclisp_init_root_scope(struct veclisp_scope *root_scope) {
   veclisp_set(root_scope, VECLISP_ERRPORT, value);
   value.as.integer = (int64_t)veclisp_n_quote;
   veclisp_set(root_scope, VECLISP_QUOTE, value);
+  value.as.integer = (int64_t)veclisp_n_quasiquote;
+  veclisp_set(root_scope, VECLISP_QUASIQUOTE, value);
   value.as.integer = (int64_t)veclisp_n_intp;
   veclisp_set(root_scope, veclisp_intern("int?"), value);
   value.as.integer = (int64_t)veclisp_n_symp;
@@ -306,6 +682,12 @@ int veclisp_init_root_scope(struct veclisp_scope *root_scope) {
   veclisp_set(root_scope, veclisp_intern("sqrt"), value);
   value.as.integer = (int64_t)veclisp_n_rand;
   veclisp_set(root_scope, veclisp_intern("rand"), value);
+  value.as.integer = (int64_t)veclisp_n_randseed;
+  veclisp_set(root_scope, veclisp_intern("rand-seed"), value);
+  value.as.integer = (int64_t)veclisp_n_randrange;
+  veclisp_set(root_scope, veclisp_intern("rand-range"), value);
+  value.as.integer = (int64_t)veclisp_n_randfill;
+  veclisp_set(root_scope, veclisp_intern("rand-fill!"), value);
   value.as.integer = (int64_t)veclisp_n_max;
   veclisp_set(root_scope, veclisp_intern("max"), value);
   value.as.integer = (int64_t)veclisp_n_min;
@@ -343,9 +725,9 @@ int veclisp_init_root_scope(struct veclisp_scope *root_scope) {
   value.as.integer = (int64_t)veclisp_n_close;
   veclisp_set(root_scope, veclisp_intern("close"), value);
   value.as.integer = (int64_t)veclisp_n_map;
-  veclisp_set(root_scope, veclisp_intern("map"), value);
+  veclisp_set(root_scope, VECLISP_MAP, value);
   value.as.integer = (int64_t)veclisp_n_filter;
-  veclisp_set(root_scope, veclisp_intern("filter"), value);
+  veclisp_set(root_scope, VECLISP_FILTER, value);
   value.as.integer = (int64_t)veclisp_n_let;
   veclisp_set(root_scope, veclisp_intern("let"), value);
   value.as.integer = (int64_t)veclisp_n_read;
@@ -365,7 +747,7 @@ int veclisp_init_root_scope(struct veclisp_scope *root_scope) {
   value.as.integer = (int64_t)veclisp_n_pack;
   veclisp_set(root_scope, veclisp_intern("pack"), value);
   value.as.integer = (int64_t)veclisp_n_fold;
-  veclisp_set(root_scope, veclisp_intern("fold"), value);
+  veclisp_set(root_scope, VECLISP_FOLD, value);
   value.as.integer = (int64_t)veclisp_n_unfoldpair;
   veclisp_set(root_scope, veclisp_intern("unfold-pair"), value);
   value.as.integer = (int64_t)veclisp_n_unfoldvec;
@@ -378,11 +760,129 @@ int veclisp_init_root_scope(struct veclisp_scope *root_scope) {
   veclisp_set(root_scope, veclisp_intern("find"), value);
   value.as.integer = (int64_t)veclisp_n_if;
   veclisp_set(root_scope, veclisp_intern("if"), value);
+  value.as.integer = (int64_t)veclisp_n_lazyunfold;
+  veclisp_set(root_scope, veclisp_intern("lazy-unfold"), value);
+  value.as.integer = (int64_t)veclisp_n_lazyread;
+  veclisp_set(root_scope, veclisp_intern("lazy-read"), value);
+  value.as.integer = (int64_t)veclisp_n_pipe;
+  veclisp_set(root_scope, veclisp_intern("pipe"), value);
+  value.as.integer = (int64_t)veclisp_n_while;
+  veclisp_set(root_scope, veclisp_intern("while"), value);
+  value.as.integer = (int64_t)veclisp_n_dotimes;
+  veclisp_set(root_scope, veclisp_intern("dotimes"), value);
+  value.as.integer = (int64_t)veclisp_n_forrange;
+  veclisp_set(root_scope, veclisp_intern("for-range"), value);
+  value.as.integer = (int64_t)veclisp_n_range;
+  veclisp_set(root_scope, veclisp_intern("range"), value);
+  value.as.integer = (int64_t)veclisp_n_bytes;
+  veclisp_set(root_scope, veclisp_intern("bytes"), value);
+  value.as.integer = (int64_t)veclisp_n_makebytes;
+  veclisp_set(root_scope, veclisp_intern("make-bytes"), value);
+  value.as.integer = (int64_t)veclisp_n_readline;
+  veclisp_set(root_scope, veclisp_intern("read-line"), value);
+  value.as.integer = (int64_t)veclisp_n_readlineinto;
+  veclisp_set(root_scope, veclisp_intern("read-line-into"), value);
+  value.as.integer = (int64_t)veclisp_n_readbytes;
+  veclisp_set(root_scope, veclisp_intern("read-bytes"), value);
+  value.as.integer = (int64_t)veclisp_n_readbytesinto;
+  veclisp_set(root_scope, veclisp_intern("read-bytes-into"), value);
+  value.as.integer = (int64_t)veclisp_n_mapfile;
+  veclisp_set(root_scope, veclisp_intern("map-file"), value);
+  value.as.integer = (int64_t)veclisp_n_readallparallel;
+  veclisp_set(root_scope, veclisp_intern("read-all-parallel"), value);
+  value.as.integer = (int64_t)veclisp_n_slice;
+  veclisp_set(root_scope, veclisp_intern("slice"), value);
+  value.as.integer = (int64_t)veclisp_n_subvec;
+  veclisp_set(root_scope, veclisp_intern("subvec"), value);
+  value.as.integer = (int64_t)veclisp_n_vectorcopy;
+  veclisp_set(root_scope, veclisp_intern("vector-copy!"), value);
+  value.as.integer = (int64_t)veclisp_n_vectorfill;
+  veclisp_set(root_scope, veclisp_intern("vector-fill!"), value);
+  value.as.integer = (int64_t)veclisp_n_vectorconcat;
+  veclisp_set(root_scope, veclisp_intern("vector-concat"), value);
+  value.as.integer = (int64_t)veclisp_n_makevector;
+  veclisp_set(root_scope, veclisp_intern("make-vector"), value);
+  value.as.integer = (int64_t)veclisp_n_vectorpush;
+  veclisp_set(root_scope, veclisp_intern("vector-push!"), value);
+  value.as.integer = (int64_t)veclisp_n_vectorpop;
+  veclisp_set(root_scope, veclisp_intern("vector-pop!"), value);
+  value.as.integer = (int64_t)veclisp_n_vectorreserve;
+  veclisp_set(root_scope, veclisp_intern("vector-reserve!"), value);
+  value.as.integer = (int64_t)veclisp_n_vectorcapacity;
+  veclisp_set(root_scope, veclisp_intern("vector-capacity"), value);
+  value.as.integer = (int64_t)veclisp_n_socketpair;
+  veclisp_set(root_scope, veclisp_intern("socketpair"), value);
+  value.as.integer = (int64_t)veclisp_n_unixlisten;
+  veclisp_set(root_scope, veclisp_intern("unix-listen"), value);
+  value.as.integer = (int64_t)veclisp_n_unixconnect;
+  veclisp_set(root_scope, veclisp_intern("unix-connect"), value);
+  value.as.integer = (int64_t)veclisp_n_accept;
+  veclisp_set(root_scope, veclisp_intern("accept"), value);
+  value.as.integer = (int64_t)veclisp_n_fdread;
+  veclisp_set(root_scope, veclisp_intern("fd-read"), value);
+  value.as.integer = (int64_t)veclisp_n_fdwrite;
+  veclisp_set(root_scope, veclisp_intern("fd-write"), value);
+  value.as.integer = (int64_t)veclisp_n_fdclose;
+  veclisp_set(root_scope, veclisp_intern("fd-close"), value);
+  value.as.integer = (int64_t)veclisp_n_fdport;
+  veclisp_set(root_scope, veclisp_intern("fd-port"), value);
+  value.as.integer = (int64_t)veclisp_n_flush;
+  veclisp_set(root_scope, veclisp_intern("flush"), value);
+  value.as.integer = (int64_t)veclisp_n_onreadable;
+  veclisp_set(root_scope, veclisp_intern("on-readable"), value);
+  value.as.integer = (int64_t)veclisp_n_onwritable;
+  veclisp_set(root_scope, veclisp_intern("on-writable"), value);
+  value.as.integer = (int64_t)veclisp_n_eventloop;
+  veclisp_set(root_scope, veclisp_intern("event-loop"), value);
+  value.as.integer = (int64_t)veclisp_n_spawn;
+  veclisp_set(root_scope, veclisp_intern("spawn"), value);
+  value.as.integer = (int64_t)veclisp_n_yield;
+  veclisp_set(root_scope, veclisp_intern("yield"), value);
+  value.as.integer = (int64_t)veclisp_n_run;
+  veclisp_set(root_scope, veclisp_intern("run"), value);
+  value.as.integer = (int64_t)veclisp_n_chan;
+  veclisp_set(root_scope, veclisp_intern("chan"), value);
+  value.as.integer = (int64_t)veclisp_n_chansend;
+  veclisp_set(root_scope, veclisp_intern("chan-send"), value);
+  value.as.integer = (int64_t)veclisp_n_chanrecv;
+  veclisp_set(root_scope, veclisp_intern("chan-recv"), value);
+  value.as.integer = (int64_t)veclisp_n_chanclose;
+  veclisp_set(root_scope, veclisp_intern("chan-close"), value);
+  value.as.integer = (int64_t)veclisp_n_runisolate;
+  veclisp_set(root_scope, veclisp_intern("run-isolate"), value);
+  value.as.integer = (int64_t)veclisp_n_joinisolate;
+  veclisp_set(root_scope, veclisp_intern("join-isolate"), value);
+  value.as.integer = (int64_t)veclisp_n_freeze;
+  veclisp_set(root_scope, veclisp_intern("freeze"), value);
+  value.as.integer = (int64_t)veclisp_n_frozenp;
+  veclisp_set(root_scope, veclisp_intern("frozen?"), value);
+  value.as.integer = (int64_t)veclisp_n_clock;
+  veclisp_set(root_scope, veclisp_intern("clock"), value);
+  value.as.integer = (int64_t)veclisp_n_memoize;
+  veclisp_set(root_scope, veclisp_intern("memoize"), value);
+  value.as.integer = (int64_t)veclisp_n_memostats;
+  veclisp_set(root_scope, veclisp_intern("memo-stats"), value);
+  value.as.integer = (int64_t)veclisp_n_optimize;
+  veclisp_set(root_scope, veclisp_intern("optimize"), value);
+  value.as.integer = (int64_t)veclisp_n_lexical;
+  veclisp_set(root_scope, veclisp_intern("lexical"), value);
+  value.as.integer = (int64_t)veclisp_n_special;
+  veclisp_set(root_scope, veclisp_intern("special"), value);
+  value.as.integer = (int64_t)veclisp_n_callcachestats;
+  veclisp_set(root_scope, veclisp_intern("call-cache-stats"), value);
+  value.as.integer = (int64_t)veclisp_n_jit;
+  veclisp_set(root_scope, veclisp_intern("jit"), value);
+  value.as.integer = (int64_t)veclisp_n_jitstats;
+  veclisp_set(root_scope, veclisp_intern("jit-stats"), value);
   value.type = VECLISP_SYM;
   value.as.sym = VECLISP_DEFAULT_PROMPT;
   veclisp_set(root_scope, VECLISP_PROMPT, value);
   value.as.sym = VECLISP_DEFAULT_RESPONSE;
   veclisp_set(root_scope, VECLISP_RESPONSE, value);
+#ifdef VECLISP_COMPILED
+  /* library code built in with veclisp-compile */
+  if (veclisp_compiled(root_scope, &value)) return 1;
+#endif
   return 0;
 }
 int skip_space(FILE *in) {
@@ -394,7 +894,64 @@ int skip_space(FILE *in) {
 struct veclisp_cell *veclisp_alloc_pair() {
   return GC_malloc(sizeof(struct veclisp_cell) * 2);
 }
+/* a pair of the form being read */
+struct veclisp_cell *veclisp_alloc_literal_pair(void) {
+  struct veclisp_cell *pair = GC_malloc(sizeof(*pair) * 3);
+  pair[2].type = VECLISP_LITERAL;
+  pair[2].as.integer = (int64_t)veclisp_reading;
+  return pair;
+}
+/* the form the block p of cells cells was read in, or NULL if the
+   reader did not make it */
+struct veclisp_literal *veclisp_literal(struct veclisp_cell *p, int64_t cells) {
+  if (p == NULL || GC_base(p) != p || GC_size(p) < sizeof(*p) * (cells + 1) || p[cells].type != VECLISP_LITERAL) return NULL;
+  return (struct veclisp_literal *)p[cells].as.integer;
+}
+/* the form the storage of vec, or of the vector it views, was read in */
+struct veclisp_literal *veclisp_vec_literal(struct veclisp_cell *vec) {
+  struct veclisp_cell *base = vec;
+  if (vec[0].type != VECLISP_INT && (base = GC_base(vec[0].as.vec)) == NULL) return NULL;
+  if (base[0].type != VECLISP_INT) return NULL;
+  return veclisp_literal(base, base[0].as.integer + 1);
+}
+/* whether every pair and vector in value was read in with literal */
+int veclisp_literal_whole(struct veclisp_cell value, struct veclisp_literal *literal) {
+  int64_t i;
+  for (;;) {
+    switch (value.type) {
+    case VECLISP_PAIR:
+      if (value.as.pair == NULL) return 1;
+      if (veclisp_literal(value.as.pair, 2) != literal || !veclisp_literal_whole(value.as.pair[0], literal)) return 0;
+      value = value.as.pair[1];
+      continue;
+    case VECLISP_VEC:
+      if (veclisp_vec_literal(value.as.vec) != literal) return 0;
+      FORVEC(i, value.as.vec) {
+        if (!veclisp_literal_whole(VECLISP_VELEMS(value.as.vec)[i], literal)) return 0;
+      }
+      return 1;
+    default:
+      return 1;
+    }
+  }
+}
+struct veclisp_cell *veclisp_alloc_vec(int64_t len) {
+  struct veclisp_cell *vec = GC_malloc(sizeof(*vec) * (len + 1));
+  vec[0].type = VECLISP_INT;
+  vec[0].as.integer = len;
+  return vec;
+}
+int veclisp_read_form(struct veclisp_scope *scope, struct veclisp_cell *result);
 int veclisp_read(struct veclisp_scope *scope, struct veclisp_cell *result) {
+  struct veclisp_literal *literal;
+  int err;
+  if (veclisp_reading != NULL) return veclisp_read_form(scope, result);
+  veclisp_reading = literal = GC_malloc(sizeof(*literal));
+  err = veclisp_read_form(scope, result);
+  veclisp_reading = NULL;
+  return err;
+}
+int veclisp_read_form(struct veclisp_scope *scope, struct veclisp_cell *result) {
   int c, sign = 1, buf_allocated, buf_used;
   char *sym_buf;
   struct veclisp_cell inport, *p;
@@ -415,11 +972,15 @@ int veclisp_read(struct veclisp_scope *scope, struct veclisp_cell *result) {
       result->as.pair = NULL;
       return 0;
     }
-    result->as.pair = veclisp_alloc_pair();
+    result->as.pair = veclisp_alloc_literal_pair();
     ungetc(c, (FILE *)inport.as.integer);
-    for (p = result->as.pair; p != NULL; p[1].as.pair = veclisp_alloc_pair(), p = p[1].as.pair) {
+    for (p = result->as.pair; p != NULL; p[1].as.pair = veclisp_alloc_literal_pair(), p = p[1].as.pair) {
       if (veclisp_read(scope, p)) {
         *result = *p;
+        if (result->type == VECLISP_INT && result->as.integer == EOF) {
+          result->type = VECLISP_SYM;
+          result->as.sym = VECLISP_ERR_EXPECTED_CLOSE_PAREN;
+        }
         return 1;
       }
       p[1].type = VECLISP_PAIR;
@@ -452,12 +1013,23 @@ int veclisp_read(struct veclisp_scope *scope, struct veclisp_cell *result) {
       }
       c = skip_space((FILE *)inport.as.integer);
       if (c == ']') {
-        result->as.vec = GC_realloc(result->as.vec, sizeof(*result->as.vec) * buf_used);
+        /* the hidden cell, then the const verdict of veclisp_vec_const */
+        result->as.vec = GC_realloc(result->as.vec, sizeof(*result->as.vec) * (buf_used + 2));
         result->as.vec[0].as.integer = buf_used - 1;
+        result->as.vec[buf_used].type = VECLISP_LITERAL;
+        result->as.vec[buf_used].as.integer = (int64_t)veclisp_reading;
+        result->as.vec[buf_used + 1].type = VECLISP_INT;
+        result->as.vec[buf_used + 1].as.integer = 0;
         return 0;
       }
       ungetc(c, (FILE *)inport.as.integer);
     } while (!veclisp_read(scope, &result->as.vec[buf_used++]));
+    *result = result->as.vec[buf_used - 1];
+    if (result->type == VECLISP_INT && result->as.integer == EOF) {
+      result->type = VECLISP_SYM;
+      result->as.sym = VECLISP_ERR_EXPECTED_CLOSE_PAREN;
+    }
+    return 1;
   } else if (c == '-') {
     sign = -1;
     c = fgetc((FILE *)inport.as.integer);
@@ -481,6 +1053,27 @@ int veclisp_read(struct veclisp_scope *scope, struct veclisp_cell *result) {
     result->type = VECLISP_SYM;
     result->as.sym = VECLISP_ERR_EXPECTED_CLOSE_PAREN;
     return 1;
+  } else if (c == '#') {
+    c = fgetc((FILE *)inport.as.integer);
+    if (c != '"') {
+      ungetc(c, (FILE *)inport.as.integer);
+      c = '#';
+      goto read_symbol;
+    }
+    result->type = VECLISP_BYTES;
+    result->as.bytes = veclisp_alloc_bytes(0, 32);
+    for (;;) {
+      c = fgetc((FILE *)inport.as.integer);
+      if (c == EOF) break;
+      if (c == '\\') {
+        c = fgetc((FILE *)inport.as.integer);
+      } else if (c == '"') break;
+      if (result->as.bytes->length >= result->as.bytes->capacity) {
+        result->as.bytes->capacity *= 2;
+        result->as.bytes->data = GC_realloc(result->as.bytes->data, result->as.bytes->capacity);
+      }
+      result->as.bytes->data[result->as.bytes->length++] = c;
+    }
   } else if (c == '"') {
     result->type = VECLISP_SYM;
     buf_allocated = 32;
@@ -492,23 +1085,30 @@ int veclisp_read(struct veclisp_scope *scope, struct veclisp_cell *result) {
         buf_allocated *= 2;
         sym_buf = realloc(sym_buf, sizeof(*sym_buf) *buf_allocated);
       }
+      if (c == EOF) break;
       if (c == '\\') {
         c = fgetc((FILE *)inport.as.integer);
       } else if (c == '"') break;
       sym_buf[buf_used++] = c;
     }
     sym_buf[buf_used++] = 0;
-    sym_buf = realloc(sym_buf, sizeof(*sym_buf) * buf_used);
     result->as.sym = veclisp_intern(sym_buf);
+    free(sym_buf);
   } else if (c == '\'') {
     result->type = VECLISP_PAIR;
-    result->as.pair = veclisp_alloc_pair();
+    result->as.pair = veclisp_alloc_literal_pair();
     result->as.pair[0].type = VECLISP_SYM;
     result->as.pair[0].as.sym = VECLISP_QUOTE;
     return veclisp_read(scope, &result->as.pair[1]);
+  } else if (c == '`') {
+    result->type = VECLISP_PAIR;
+    result->as.pair = veclisp_alloc_literal_pair();
+    result->as.pair[0].type = VECLISP_SYM;
+    result->as.pair[0].as.sym = VECLISP_QUASIQUOTE;
+    return veclisp_read(scope, &result->as.pair[1]);
   } else if (c == ',') {
     result->type = VECLISP_PAIR;
-    result->as.pair = veclisp_alloc_pair();
+    result->as.pair = veclisp_alloc_literal_pair();
     result->as.pair[0].type = VECLISP_SYM;
     result->as.pair[0].as.sym = VECLISP_UNQUOTE;
     return veclisp_read(scope, &result->as.pair[1]);
@@ -525,6 +1125,7 @@ int veclisp_read(struct veclisp_scope *scope, struct veclisp_cell *result) {
         buf_allocated *= 2;
         sym_buf = realloc(sym_buf, sizeof(*sym_buf) * buf_allocated);
       }
+      if (c == EOF) break;
       if (isspace(c) || c == ')' || c == ']' || c == '[' || c == '(') {
         ungetc(c, (FILE *)inport.as.integer);
         break;
@@ -532,12 +1133,63 @@ int veclisp_read(struct veclisp_scope *scope, struct veclisp_cell *result) {
       sym_buf[buf_used++] = c;
     }
     sym_buf[buf_used++] = 0;
-    sym_buf = realloc(sym_buf, sizeof(*sym_buf) * buf_used);
     result->as.sym = veclisp_intern(sym_buf);
+    free(sym_buf);
     return 0;
   }
   return 0;
 }
+/* note a write into storage that may belong to a literal */
+void veclisp_wrote_literal(struct veclisp_literal *literal) {
+  if (literal != NULL) __atomic_add_fetch(&literal->writes, 1, __ATOMIC_RELAXED);
+}
+/* a vector literal whose elements all evaluate to themselves evaluates
+   to a copy-on-write view of the literal rather than a fresh copy. the
+   reader leaves room after the literal for the verdict, which holds
+   until the next write into the form it was read in. vectors the reader
+   did not make are checked every time. */
+int veclisp_vec_const(struct veclisp_cell *vec) {
+  int64_t i, writes = 0, verdict = 0;
+  struct veclisp_literal *literal = vec[0].type == VECLISP_INT ? veclisp_vec_literal(vec) : NULL;
+  struct veclisp_cell *elems, *cached = NULL;
+  if (literal != NULL) {
+    writes = __atomic_load_n(&literal->writes, __ATOMIC_RELAXED);
+    cached = &vec[vec[0].as.integer + 2];
+    verdict = __atomic_load_n(&cached->as.integer, __ATOMIC_RELAXED);
+  }
+  if (verdict != 0 && verdict >> 2 == writes) return (verdict & 3) == 1;
+  verdict = 1;
+  elems = VECLISP_VELEMS(vec);
+  FORVEC(i, vec) {
+    switch (elems[i].type) {
+    case VECLISP_INT:
+    case VECLISP_LAZY:
+    case VECLISP_BYTES:
+    case VECLISP_CHAN:
+      continue;
+    case VECLISP_PAIR:
+      if (elems[i].as.pair == NULL) continue;
+    default:
+      verdict = 2;
+    }
+    break;
+  }
+  if (cached != NULL) __atomic_store_n(&cached->as.integer, writes << 2 | verdict, __ATOMIC_RELAXED);
+  return verdict == 1;
+}
+/* the elements of vec, copied first if it is a copy-on-write view */
+struct veclisp_cell *veclisp_vec_writable(struct veclisp_cell *vec) {
+  struct veclisp_cell *elems;
+  if (vec[0].type == VECLISP_VEC && vec[2].type == VECLISP_VEC) {
+    elems = GC_malloc(sizeof(*elems) * (vec[1].as.integer + 1));
+    memcpy(elems + 1, vec[0].as.vec + 1, sizeof(*elems) * vec[1].as.integer);
+    vec[0].as.vec = elems;
+    vec[2].type = VECLISP_PAIR;
+    vec[2].as.pair = NULL;
+  }
+  veclisp_wrote_literal(veclisp_vec_literal(vec));
+  return VECLISP_VELEMS(vec);
+}
 int veclisp_eval(struct veclisp_scope *scope, struct veclisp_cell value, struct veclisp_cell *result) {
   int64_t i;
   switch (value.type) {
@@ -548,36 +1200,85 @@ int veclisp_eval(struct veclisp_scope *scope, struct veclisp_cell value, struct
     veclisp_scope_lookup(scope, value.as.sym, result);
     return 0;
   case VECLISP_VEC:
+    if (veclisp_vec_const(value.as.vec)) {
+      result->type = VECLISP_VEC;
+      result->as.vec = GC_malloc(sizeof(*result->as.vec) * 3);
+      result->as.vec[0].type = VECLISP_VEC;
+      result->as.vec[0].as.vec = VECLISP_VELEMS(value.as.vec);
+      result->as.vec[1].type = VECLISP_INT;
+      result->as.vec[1].as.integer = VECLISP_VLEN(value.as.vec);
+      result->as.vec[2] = value;
+      return 0;
+    }
     result->type = VECLISP_VEC;
-    result->as.vec = GC_malloc(sizeof(struct veclisp_cell) * (value.as.vec[0].as.integer + 1));
-    result->as.vec[0] = value.as.vec[0];
-    for (i = 1; i <= value.as.vec[0].as.integer; ++i)
-      if (veclisp_eval(scope, value.as.vec[i], &result->as.vec[i])) return 1;
+    result->as.vec = veclisp_alloc_vec(VECLISP_VLEN(value.as.vec));
+    FORVEC(i, result->as.vec)
+      if (veclisp_eval(scope, VECLISP_VELEMS(value.as.vec)[i], &result->as.vec[i])) return 1;
     return 0;
   case VECLISP_PAIR:
     if (value.as.pair == NULL) {
       *result = value;
       return 0;
     }
+    /* slot references of lexical code skip the call machinery */
+    if (value.as.pair[0].type == VECLISP_INT && value.as.pair[0].as.integer == (int64_t)veclisp_n_lexref)
+      return veclisp_n_lexref(scope, value.as.pair[1], result);
     return veclisp_n_call(scope, value, result);
+  case VECLISP_LAZY:
+  case VECLISP_BYTES:
+  case VECLISP_CHAN:
+    *result = value;
+    return 0;
   default:
     return 1;
   }
 }
-int veclisp_scope_lookup(struct veclisp_scope *scope, char *sym, struct veclisp_cell *result) {
+struct veclisp_bindings *veclisp_scope_binding(struct veclisp_scope *scope, char *sym) {
   struct veclisp_scope *s;
   struct veclisp_bindings *b;
   FORNEXT(s, scope) {
     FORNEXT(b, s->bindings) {
-      if (b->sym == sym) {
-        *result = b->value;
-        return 0;
-      }
+      if (b->sym == sym) return b;
     }
   }
-  result->type = VECLISP_PAIR;
-  result->as.pair = NULL;
-  return 1;
+  return NULL;
+}
+int veclisp_scope_lookup(struct veclisp_scope *scope, char *sym, struct veclisp_cell *result) {
+  struct veclisp_bindings *b = veclisp_scope_binding(scope, sym);
+  if (b == NULL) {
+    result->type = VECLISP_PAIR;
+    result->as.pair = NULL;
+    return 1;
+  }
+  *result = b->value;
+  return 0;
+}
+/* looks up the head symbol of the call form site. a symbol never bound
+   locally can only have its global binding, so that binding is kept
+   for the site and read directly next time. */
+void veclisp_call_lookup(struct veclisp_scope *scope, struct veclisp_cell *site, struct veclisp_cell *result) {
+  struct veclisp_interp *interp = veclisp_current;
+  struct veclisp_call_cache *c = &interp->call_cache[((uint64_t)site >> 4) & (VECLISP_CALL_CACHE - 1)];
+  char *sym = site[0].as.sym;
+  struct veclisp_bindings *b;
+  int shadowed = ((unsigned char *)sym)[-1] & VECLISP_SYM_SHADOWED;
+  if (c->site == site && c->sym == sym && c->version == interp->global_version && !shadowed) {
+    interp->call_cache_hits++;
+    *result = c->binding->value;
+    return;
+  }
+  interp->call_cache_misses++;
+  if ((b = veclisp_scope_binding(scope, sym)) == NULL) {
+    result->type = VECLISP_PAIR;
+    result->as.pair = NULL;
+    return;
+  }
+  *result = b->value;
+  if (shadowed) return;
+  c->site = site;
+  c->sym = sym;
+  c->binding = b;
+  c->version = interp->global_version;
 }
 void veclisp_set(struct veclisp_scope *scope, char *interned_sym, struct veclisp_cell value) {
   struct veclisp_scope *s = NULL;
@@ -586,12 +1287,14 @@ void veclisp_set(struct veclisp_scope *scope, char *interned_sym, struct veclisp
     if (s->bindings) {
       FORNEXT(b, s->bindings) {
         if (b->sym == interned_sym) {
+          veclisp_rebind(interned_sym);
           b->value = value;
           return;
         }
       }
     }
     if (!s->next) {
+      if (veclisp_current != NULL) veclisp_current->global_version++;
       b = GC_malloc(sizeof(*b));
       b->next = s->bindings;
       b->sym = interned_sym;
@@ -612,6 +1315,7 @@ int veclisp_contains_special_chars(char *sym) {
       return 1;
     case '.':
     case '\'':
+    case '`':
     case ',':
       if (i == 0) return 1;
     }
@@ -657,24 +1361,193 @@ void veclisp_fwrite(FILE *out, struct veclisp_cell value) {
     fputc(')', out);
     break;
   case VECLISP_VEC:
-    len = (int64_t)value.as.vec[0].as.integer;
+    len = VECLISP_VLEN(value.as.vec);
     if (len < 0) {
       fprintf(out, "(INVALID VECTOR LEN %li)", len);
     } else {
       fputc('[', out);
       for (i = 1; i <= len; ++i) {
-        veclisp_fwrite(out, value.as.vec[i]);
+        veclisp_fwrite(out, VECLISP_VELEMS(value.as.vec)[i]);
         if (i != len) fputc(' ', out);
       }
       fputc(']', out);
     }
     break;
+  case VECLISP_LAZY:
+    fputs("#lazy", out);
+    break;
+  case VECLISP_CHAN:
+    fputs("#chan", out);
+    break;
+  case VECLISP_BYTES:
+    fputs("#\"", out);
+    for (i = 0; i < value.as.bytes->length; ++i) {
+      if (value.as.bytes->data[i] == '"' || value.as.bytes->data[i] == '\\') fputc('\\', out);
+      fputc(value.as.bytes->data[i], out);
+    }
+    fputc('"', out);
+    break;
   }
 }
 int veclisp_n_quote(struct veclisp_scope *scope, struct veclisp_cell value, struct veclisp_cell *result) {
   *result = value;
   return 0;
 }
+void *veclisp_ptrmap_get(struct veclisp_ptrmap *map, void *key) {
+  uint64_t i;
+  void *stored = map->weak ? (void *)GC_HIDE_POINTER(key) : key;
+  if (map->allocated == 0) return NULL;
+  for (i = ((uint64_t)key >> 4) * 0x9e3779b97f4a7c15ULL;; ++i) {
+    i &= map->allocated - 1;
+    if (map->entries[i].key == stored) return map->entries[i].value;
+    if (map->entries[i].key == NULL) return NULL;
+  }
+}
+/* a weak map only takes keys the collector can tell are unreachable:
+   heap objects and frozen data. other keys are not remembered. */
+int veclisp_weak_key(void *key) {
+  return GC_base(key) == key || veclisp_frozen_p(key);
+}
+void veclisp_ptrmap_put(struct veclisp_ptrmap *map, void *key, void *value) {
+  int64_t j, old_allocated;
+  uint64_t i;
+  struct veclisp_ptrmap_entry *old_entries;
+  void *stored = key, *old_key, *base = NULL;
+  if (map->weak) {
+    if (!veclisp_weak_key(key)) return;
+    /* a frozen key goes with the chunk it is in */
+    base = GC_base(key);
+    stored = (void *)GC_HIDE_POINTER(key);
+  }
+  if (2 * (map->used + 1) > map->allocated) {
+    old_allocated = map->allocated;
+    old_entries = map->entries;
+    map->allocated = old_allocated ? old_allocated * 2 : 64;
+    map->entries = GC_malloc(sizeof(*map->entries) * map->allocated);
+    map->used = 0;
+    for (j = 0; j < old_allocated; ++j) {
+      if (old_entries[j].key == NULL) continue;
+      old_key = old_entries[j].key;
+      if (map->weak) {
+        old_key = GC_REVEAL_POINTER((GC_hidden_pointer)old_key);
+        GC_unregister_disappearing_link(&old_entries[j].key);
+      }
+      veclisp_ptrmap_put(map, old_key, old_entries[j].value);
+    }
+  }
+  for (i = ((uint64_t)key >> 4) * 0x9e3779b97f4a7c15ULL;; ++i) {
+    i &= map->allocated - 1;
+    if (map->entries[i].key == stored) {
+      map->entries[i].value = value;
+      return;
+    }
+    if (map->entries[i].key == NULL) {
+      map->entries[i].key = stored;
+      map->entries[i].value = value;
+      map->used++;
+      if (base != NULL) GC_general_register_disappearing_link(&map->entries[i].key, base);
+      return;
+    }
+  }
+}
+/* a template is analysed once into a plan mirroring only the spines that
+   lead to unquoted holes. everything else is shared with the template.
+   mixed is set if any of the template was not read in with literal. */
+struct veclisp_qq *veclisp_qq_analyse(struct veclisp_cell template, struct veclisp_literal *literal, int *mixed) {
+  int64_t i, holes = 0;
+  struct veclisp_qq *plan = GC_malloc(sizeof(*plan));
+  plan->kind = VECLISP_QQ_CONST;
+  plan->value = template;
+  switch (template.type) {
+  case VECLISP_PAIR:
+    if (template.as.pair == NULL) break;
+    if (veclisp_literal(template.as.pair, 2) != literal) *mixed = 1;
+    if (template.as.pair[0].type == VECLISP_SYM && template.as.pair[0].as.sym == VECLISP_UNQUOTE) {
+      plan->kind = VECLISP_QQ_HOLE;
+      plan->value = template.as.pair[1];
+      break;
+    }
+    plan->head = veclisp_qq_analyse(template.as.pair[0], literal, mixed);
+    plan->tail = veclisp_qq_analyse(template.as.pair[1], literal, mixed);
+    if (plan->head->kind != VECLISP_QQ_CONST || plan->tail->kind != VECLISP_QQ_CONST)
+      plan->kind = VECLISP_QQ_PAIR;
+    break;
+  case VECLISP_VEC:
+    if (veclisp_vec_literal(template.as.vec) != literal) *mixed = 1;
+    plan->elems = GC_malloc(sizeof(*plan->elems) * (1 + VECLISP_VLEN(template.as.vec)));
+    FORVEC(i, template.as.vec) {
+      plan->elems[i] = veclisp_qq_analyse(VECLISP_VELEMS(template.as.vec)[i], literal, mixed);
+      if (plan->elems[i]->kind != VECLISP_QQ_CONST) holes++;
+    }
+    if (holes) plan->kind = VECLISP_QQ_VEC;
+    break;
+  default: break;
+  }
+  return plan;
+}
+int veclisp_qq_instantiate(struct veclisp_scope *scope, struct veclisp_qq *plan, struct veclisp_cell *result) {
+  int64_t i;
+  for (;;) {
+    switch (plan->kind) {
+    case VECLISP_QQ_CONST:
+      *result = plan->value;
+      return 0;
+    case VECLISP_QQ_HOLE:
+      return veclisp_eval(scope, plan->value, result);
+    case VECLISP_QQ_VEC:
+      result->type = VECLISP_VEC;
+      result->as.vec = veclisp_alloc_vec(VECLISP_VLEN(plan->value.as.vec));
+      FORVEC(i, result->as.vec) {
+        if (veclisp_qq_instantiate(scope, plan->elems[i], &result->as.vec[i])) return 1;
+      }
+      return 0;
+    case VECLISP_QQ_PAIR:
+      result->type = VECLISP_PAIR;
+      result->as.pair = veclisp_alloc_pair();
+      if (veclisp_qq_instantiate(scope, plan->head, &result->as.pair[0])) return 1;
+      result = &result->as.pair[1];
+      plan = plan->tail;
+    }
+  }
+}
+int veclisp_n_quasiquote(struct veclisp_scope *scope, struct veclisp_cell template, struct veclisp_cell *result) {
+  struct veclisp_qq_plan *cached;
+  struct veclisp_literal *literal;
+  struct veclisp_qq *plan;
+  int64_t writes;
+  int mixed = 0;
+  void *key;
+  switch (template.type) {
+  case VECLISP_PAIR:
+    if (template.as.pair == NULL) {
+      *result = template;
+      return 0;
+    }
+    key = template.as.pair;
+    literal = veclisp_literal(template.as.pair, 2);
+    break;
+  case VECLISP_VEC:
+    key = template.as.vec;
+    literal = veclisp_vec_literal(template.as.vec);
+    break;
+  default:
+    *result = template;
+    return 0;
+  }
+  /* only a template read in whole as one form has a write count to
+     check a plan against; any other is analysed every time */
+  if (literal == NULL) return veclisp_qq_instantiate(scope, veclisp_qq_analyse(template, NULL, &mixed), result);
+  writes = __atomic_load_n(&literal->writes, __ATOMIC_RELAXED);
+  cached = &veclisp_current->qq_plans[((uint64_t)key >> 4) & (VECLISP_QQ_PLANS - 1)];
+  if (cached->key == key && cached->writes == writes) return veclisp_qq_instantiate(scope, cached->plan, result);
+  plan = veclisp_qq_analyse(template, literal, &mixed);
+  if (!mixed) {
+    cached->key = key;
+    cached->plan = plan;
+    cached->writes = writes;
+  }
+  return veclisp_qq_instantiate(scope, plan, result);
+}
 int veclisp_n_intp(struct veclisp_scope *scope, struct veclisp_cell value, struct veclisp_cell *result) {
   if (veclisp_eval(scope, value.as.pair[0], &value)) return 1;
   if (value.type == VECLISP_INT) {
@@ -697,6 +1570,10 @@ int veclisp_n_symp(struct veclisp_scope *scope, struct veclisp_cell value, struc
 }
 int veclisp_n_pairp(struct veclisp_scope *scope, struct veclisp_cell value, struct veclisp_cell *result) {
   if (veclisp_eval(scope, value.as.pair[0], &value)) return 1;
+  if (veclisp_force(scope, value, &value)) {
+    *result = value;
+    return 1;
+  }
   if (value.type == VECLISP_PAIR) {
     *result = value;
   } else {
@@ -717,6 +1594,10 @@ int veclisp_n_vecp(struct veclisp_scope *scope, struct veclisp_cell value, struc
 }
 int veclisp_n_nilp(struct veclisp_scope *scope, struct veclisp_cell value, struct veclisp_cell *result) {
   if (veclisp_eval(scope, value.as.pair[0], &value)) return 1;
+  if (veclisp_force(scope, value, &value)) {
+    *result = value;
+    return 1;
+  }
   if (value.type == VECLISP_PAIR && value.as.pair == NULL) {
     result->type = VECLISP_SYM;
     result->as.sym = VECLISP_T;
@@ -734,6 +1615,10 @@ int veclisp_n_pair(struct veclisp_scope *scope, struct veclisp_cell value, struc
 }
 int veclisp_n_head(struct veclisp_scope *scope, struct veclisp_cell value, struct veclisp_cell *result) {
   if (veclisp_eval(scope, value.as.pair[0], &value)) return 1;
+  if (veclisp_force(scope, value, &value)) {
+    *result = value;
+    return 1;
+  }
   if (value.type != VECLISP_PAIR || value.as.pair == NULL) {
     result->type = VECLISP_PAIR;
     result->as.pair = NULL;
@@ -744,6 +1629,10 @@ int veclisp_n_head(struct veclisp_scope *scope, struct veclisp_cell value, struc
 }
 int veclisp_n_tail(struct veclisp_scope *scope, struct veclisp_cell value, struct veclisp_cell *result) {
   if (veclisp_eval(scope, value.as.pair[0], &value)) return 1;
+  if (veclisp_force(scope, value, &value)) {
+    *result = value;
+    return 1;
+  }
   if (value.type != VECLISP_PAIR || value.as.pair == NULL) {
     result->type = VECLISP_PAIR;
     result->as.pair = NULL;
@@ -765,10 +1654,10 @@ int veclisp_compare(struct veclisp_cell x, struct veclisp_cell y) {
       else return strcmp(x.as.sym, y.as.sym);
     case VECLISP_VEC:
       if (x.as.vec == y.as.vec) return 0;
-      if (x.as.vec[0].as.integer > y.as.vec[0].as.integer) return 1;
-      if (x.as.vec[0].as.integer < y.as.vec[0].as.integer) return 1;
-      for (i = 1; i <= x.as.vec[0].as.integer; ++i) {
-        r = veclisp_compare(x.as.vec[i], y.as.vec[i]);
+      if (VECLISP_VLEN(x.as.vec) > VECLISP_VLEN(y.as.vec)) return 1;
+      if (VECLISP_VLEN(x.as.vec) < VECLISP_VLEN(y.as.vec)) return -1;
+      FORVEC(i, x.as.vec) {
+        r = veclisp_compare(VECLISP_VELEMS(x.as.vec)[i], VECLISP_VELEMS(y.as.vec)[i]);
         if (r != 0) return r;
       }
       return 0;
@@ -777,6 +1666,13 @@ int veclisp_compare(struct veclisp_cell x, struct veclisp_cell y) {
       r = veclisp_compare(x.as.pair[0], y.as.pair[0]);
       if (r != 0) return r;
       return veclisp_compare(x.as.pair[1], y.as.pair[1]);
+    case VECLISP_BYTES:
+      if (x.as.bytes == y.as.bytes) return 0;
+      r = memcmp(x.as.bytes->data, y.as.bytes->data,
+                 x.as.bytes->length < y.as.bytes->length ? x.as.bytes->length : y.as.bytes->length);
+      if (r != 0) return r < 0 ? -1 : 1;
+      if (x.as.bytes->length == y.as.bytes->length) return 0;
+      return x.as.bytes->length > y.as.bytes->length ? 1 : -1;
     default: return 0;
     }
   } else if (x.type == VECLISP_PAIR && x.as.pair == NULL) return -1;
@@ -860,6 +1756,7 @@ int veclisp_n_set(struct veclisp_scope *scope, struct veclisp_cell args, struct
     return 1;
   }
   if (veclisp_eval(scope, args.as.pair[1].as.pair[0], result)) return 1;
+  veclisp_rebind(name.as.sym);
   veclisp_set(scope, name.as.sym, *result);
   return 0;
 }
@@ -1024,22 +1921,142 @@ int veclisp_n_sqrt(struct veclisp_scope *scope, struct veclisp_cell args, struct
   result->as.integer = (int64_t)sqrtl(result->as.integer);
   return 0;
 }
+uint64_t veclisp_splitmix64(uint64_t *x) {
+  uint64_t z = (*x += 0x9e3779b97f4a7c15);
+  z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9;
+  z = (z ^ (z >> 27)) * 0x94d049bb133111eb;
+  return z ^ (z >> 31);
+}
+void veclisp_rand_seed(uint64_t seed) {
+  int i;
+  for (i = 0; i < 4; ++i) veclisp_current->rand_state[i] = veclisp_splitmix64(&seed);
+  veclisp_current->rand_seeded = 1;
+}
+#define VECLISP_ROTL(x, k) (((x) << (k)) | ((x) >> (64 - (k))))
+uint64_t veclisp_rand_next(void) {
+  uint64_t *s = veclisp_current->rand_state, r, t;
+  struct timespec ts;
+  if (!veclisp_current->rand_seeded) {
+    clock_gettime(CLOCK_REALTIME, &ts);
+    veclisp_rand_seed(((uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec)
+                      ^ (uint64_t)(uintptr_t)veclisp_current ^ ((uint64_t)getpid() << 32));
+  }
+  r = VECLISP_ROTL(s[1] * 5, 7) * 9;
+  t = s[1] << 17;
+  s[2] ^= s[0];
+  s[3] ^= s[1];
+  s[1] ^= s[2];
+  s[0] ^= s[3];
+  s[2] ^= t;
+  s[3] = VECLISP_ROTL(s[3], 45);
+  return r;
+}
+/* uniform in [0, range) by multiplying into the high word and
+   rejecting the few low words that would bias it */
+uint64_t veclisp_rand_below(uint64_t range) {
+  __uint128_t m = (__uint128_t)veclisp_rand_next() * range;
+  uint64_t threshold;
+  if ((uint64_t)m < range) {
+    threshold = -range % range;
+    while ((uint64_t)m < threshold) m = (__uint128_t)veclisp_rand_next() * range;
+  }
+  return (uint64_t)(m >> 64);
+}
+/* (rand) is a full 64-bit int from the interpreter's generator. (rand
+   SEED) needs no state and returns (VALUE . NEXT-SEED). */
 int veclisp_n_rand(struct veclisp_scope *scope, struct veclisp_cell args, struct veclisp_cell *result) {
-  unsigned int seed;
+  uint64_t seed;
   if (args.as.pair != NULL) {
-    if (veclisp_eval(scope, args.as.pair[0], result)) return 1;
-    seed = (unsigned int)result->as.integer;
+    if (veclisp_eval_int(scope, args.as.pair[0], (int64_t *)&seed, result)) return 1;
     result->type = VECLISP_PAIR;
     result->as.pair = veclisp_alloc_pair();
     result->as.pair[0].type = VECLISP_INT;
-    result->as.pair[0].as.integer = (int64_t)rand_r(&seed);
+    result->as.pair[0].as.integer = (int64_t)veclisp_splitmix64(&seed);
     result->as.pair[1].type = VECLISP_INT;
     result->as.pair[1].as.integer = (int64_t)seed;
     return 0;
   }
   result->type = VECLISP_INT;
-  result->as.integer = (int64_t)rand();
+  result->as.integer = (int64_t)veclisp_rand_next();
+  return 0;
+}
+/* (rand-seed N) restarts the interpreter's generator */
+int veclisp_n_randseed(struct veclisp_scope *scope, struct veclisp_cell args, struct veclisp_cell *result) {
+  int64_t seed;
+  if (veclisp_eval_int(scope, args.as.pair[0], &seed, result)) return 1;
+  veclisp_rand_seed((uint64_t)seed);
+  return 0;
+}
+int veclisp_rand_bounds(struct veclisp_scope *scope, struct veclisp_cell args, int64_t *lo, uint64_t *range, struct veclisp_cell *result) {
+  int64_t hi;
+  if (veclisp_eval_int(scope, args.as.pair[0], lo, result)) return 1;
+  if (veclisp_eval_int(scope, args.as.pair[1].as.pair[0], &hi, result)) return 1;
+  if (hi <= *lo) {
+    result->type = VECLISP_SYM;
+    result->as.sym = VECLISP_ERR_OUT_OF_RANGE;
+    return 1;
+  }
+  *range = (uint64_t)hi - (uint64_t)*lo;
+  return 0;
+}
+/* (rand-range LO HI) is uniform in [LO, HI) */
+int veclisp_n_randrange(struct veclisp_scope *scope, struct veclisp_cell args, struct veclisp_cell *result) {
+  int64_t lo;
+  uint64_t range;
+  if (veclisp_rand_bounds(scope, args, &lo, &range, result)) return 1;
+  result->type = VECLISP_INT;
+  result->as.integer = (int64_t)((uint64_t)lo + veclisp_rand_below(range));
+  return 0;
+}
+/* (rand-fill! V [LO HI]) fills a vector with ints or bytes with bytes,
+   drawn from [LO, HI) when given, and returns V */
+int veclisp_n_randfill(struct veclisp_scope *scope, struct veclisp_cell args, struct veclisp_cell *result) {
+  struct veclisp_cell target, *elems;
+  struct veclisp_bytes *b;
+  int64_t lo = 0, len, i;
+  uint64_t range = 0, x;
+  if (veclisp_eval(scope, args.as.pair[0], &target)) {
+    *result = target;
+    return 1;
+  }
+  if (args.as.pair[1].as.pair != NULL
+      && veclisp_rand_bounds(scope, args.as.pair[1], &lo, &range, result))
+    return 1;
+  if (target.type == VECLISP_VEC) {
+    if (veclisp_frozen_p(VECLISP_VELEMS(target.as.vec))) goto read_only;
+    elems = veclisp_vec_writable(target.as.vec) + 1;
+    len = VECLISP_VLEN(target.as.vec);
+    for (i = 0; i < len; ++i) {
+      elems[i].type = VECLISP_INT;
+      elems[i].as.integer = (int64_t)(range ? (uint64_t)lo + veclisp_rand_below(range) : veclisp_rand_next());
+    }
+  } else if (target.type == VECLISP_BYTES) {
+    b = target.as.bytes;
+    if (b->flags & VECLISP_BYTES_READONLY) goto read_only;
+    if (range && (lo < 0 || lo + (int64_t)range > 256)) {
+      result->type = VECLISP_SYM;
+      result->as.sym = VECLISP_ERR_OUT_OF_RANGE;
+      return 1;
+    }
+    if (range) {
+      for (i = 0; i < b->length; ++i) b->data[i] = (unsigned char)(lo + veclisp_rand_below(range));
+    } else {
+      for (i = 0; i < b->length; i += sizeof(x)) {
+        x = veclisp_rand_next();
+        memcpy(b->data + i, &x, b->length - i < (int64_t)sizeof(x) ? b->length - i : (int64_t)sizeof(x));
+      }
+    }
+  } else {
+    result->type = VECLISP_SYM;
+    result->as.sym = VECLISP_ERR_EXPECTED_VEC;
+    return 1;
+  }
+  *result = target;
   return 0;
+read_only:
+  result->type = VECLISP_SYM;
+  result->as.sym = VECLISP_ERR_READ_ONLY;
+  return 1;
 }
 int veclisp_n_max(struct veclisp_scope *scope, struct veclisp_cell args, struct veclisp_cell *result) {
   struct veclisp_cell *a, x, y;
@@ -1071,19 +2088,44 @@ int veclisp_n_length(struct veclisp_scope *scope, struct veclisp_cell args, stru
     FORPAIR(a, &l) result->as.integer++;
     break;
   case VECLISP_VEC:
-    result->as.integer = l.as.vec[0].as.integer;
+    result->as.integer = VECLISP_VLEN(l.as.vec);
     break;
   case VECLISP_SYM:
     result->as.integer = strlen(l.as.sym);
+    break;
+  case VECLISP_BYTES:
+    result->as.integer = l.as.bytes->length;
+    break;
   default: break;
   }
   return 0;
 }
+/* an index into v, which a mapped file must never be read past */
+int veclisp_index_arg(struct veclisp_cell v, struct veclisp_cell i, struct veclisp_cell *result) {
+  int64_t len = v.type == VECLISP_BYTES ? v.as.bytes->length : VECLISP_VLEN(v.as.vec);
+  if (i.type != VECLISP_INT) {
+    result->type = VECLISP_SYM;
+    result->as.sym = VECLISP_ERR_EXPECTED_INT;
+    return 1;
+  }
+  if (i.as.integer < 0 || i.as.integer >= len) {
+    result->type = VECLISP_SYM;
+    result->as.sym = VECLISP_ERR_OUT_OF_RANGE;
+    return 1;
+  }
+  return 0;
+}
 int veclisp_n_vectorref(struct veclisp_scope *scope, struct veclisp_cell args, struct veclisp_cell *result) {
   struct veclisp_cell v, i;
   if (veclisp_eval(scope, args.as.pair[0], &v)) return 1;
   if (veclisp_eval(scope, args.as.pair[1].as.pair[0], &i)) return 1;
-  *result = v.as.vec[1 + i.as.integer];
+  if ((v.type == VECLISP_BYTES || v.type == VECLISP_VEC) && veclisp_index_arg(v, i, result)) return 1;
+  if (v.type == VECLISP_BYTES) {
+    result->type = VECLISP_INT;
+    result->as.integer = v.as.bytes->data[i.as.integer];
+    return 0;
+  }
+  *result = VECLISP_VELEMS(v.as.vec)[1 + i.as.integer];
   return 0;
 }
 int veclisp_n_vectorset(struct veclisp_scope *scope, struct veclisp_cell args, struct veclisp_cell *result) {
@@ -1091,7 +2133,23 @@ int veclisp_n_vectorset(struct veclisp_scope *scope, struct veclisp_cell args, s
   if (veclisp_eval(scope, args.as.pair[0], &v)) return 1;
   if (veclisp_eval(scope, args.as.pair[1].as.pair[0], &i)) return 1;
   if (veclisp_eval(scope, args.as.pair[1].as.pair[1].as.pair[0], &x)) return 1;
-  v.as.vec[1 + i.as.integer] = x;
+  if ((v.type == VECLISP_BYTES || v.type == VECLISP_VEC) && veclisp_index_arg(v, i, result)) return 1;
+  if (v.type == VECLISP_BYTES) {
+    if (v.as.bytes->flags & VECLISP_BYTES_READONLY) {
+      result->type = VECLISP_SYM;
+      result->as.sym = VECLISP_ERR_READ_ONLY;
+      return 1;
+    }
+    v.as.bytes->data[i.as.integer] = x.as.integer;
+    *result = x;
+    return 0;
+  }
+  if (veclisp_frozen_p(VECLISP_VELEMS(v.as.vec))) {
+    result->type = VECLISP_SYM;
+    result->as.sym = VECLISP_ERR_READ_ONLY;
+    return 1;
+  }
+  veclisp_vec_writable(v.as.vec)[1 + i.as.integer] = x;
   *result = x;
   return 0;
 }
@@ -1119,7 +2177,7 @@ int veclisp_n_upval(struct veclisp_scope *scope, struct veclisp_cell args, struc
   struct veclisp_scope *s;
   if (veclisp_eval(scope, args.as.pair[0], result)) return 1;
   FORNEXT(s, scope) {
-    if (s->bindings[0].value.type == VECLISP_INT && s->bindings[0].value.as.integer == (int64_t)s) {
+    if (s->bindings && s->bindings[0].value.type == VECLISP_INT && s->bindings[0].value.as.integer == (int64_t)s) {
       return veclisp_eval(s->next->next, *result, result);
     }
   }
@@ -1129,6 +2187,11 @@ int veclisp_n_begin(struct veclisp_scope *scope, struct veclisp_cell args, struc
   struct veclisp_cell *a;
   struct veclisp_scope begin_scope;
   struct veclisp_bindings begin_bindings[2];
+  if (args.as.pair == NULL) {
+    result->type = VECLISP_PAIR;
+    result->as.pair = NULL;
+    return 0;
+  }
   begin_scope.bindings = begin_bindings;
   begin_scope.next = scope;
   begin_bindings[0].sym = "";
@@ -1152,7 +2215,13 @@ int veclisp_n_sethead(struct veclisp_scope *scope, struct veclisp_cell args, str
     result->as.sym = VECLISP_ERR_EXPECTED_PAIR;
     return 1;
   }
+  if (veclisp_frozen_p(pair.as.pair)) {
+    result->type = VECLISP_SYM;
+    result->as.sym = VECLISP_ERR_READ_ONLY;
+    return 1;
+  }
   if (veclisp_eval(scope, args.as.pair[1].as.pair[0], result)) return 1;
+  veclisp_wrote_literal(veclisp_literal(pair.as.pair, 2));
   pair.as.pair[0] = *result;
   return 0;
 }
@@ -1164,7 +2233,13 @@ int veclisp_n_settail(struct veclisp_scope *scope, struct veclisp_cell args, str
     result->as.sym = VECLISP_ERR_EXPECTED_PAIR;
     return 1;
   }
+  if (veclisp_frozen_p(pair.as.pair)) {
+    result->type = VECLISP_SYM;
+    result->as.sym = VECLISP_ERR_READ_ONLY;
+    return 1;
+  }
   if (veclisp_eval(scope, args.as.pair[1].as.pair[0], result)) return 1;
+  veclisp_wrote_literal(veclisp_literal(pair.as.pair, 2));
   pair.as.pair[1] = *result;
   return 0;
 }
@@ -1221,13 +2296,14 @@ int veclisp_n_list(struct veclisp_scope *scope, struct veclisp_cell args, struct
 }
 int veclisp_n_call(struct veclisp_scope *scope, struct veclisp_cell args, struct veclisp_cell *result) {
   struct veclisp_cell lambda_head, lambda_tail, *t, *a;
-  if (veclisp_eval(scope, args.as.pair[0], &lambda_head)) return 1;
+  if (args.as.pair[0].type == VECLISP_SYM) veclisp_call_lookup(scope, args.as.pair, &lambda_head);
+  else if (veclisp_eval(scope, args.as.pair[0], &lambda_head)) return 1;
   if (lambda_head.type == VECLISP_PAIR && lambda_head.as.pair == NULL) {
     *result = args.as.pair[0];
     return 1;
   }
   lambda_tail = args.as.pair[1];
-  if (lambda_head.type == VECLISP_PAIR && lambda_head.as.pair[0].type == VECLISP_PAIR) {
+  if (lambda_head.type == VECLISP_PAIR && (lambda_head.as.pair[0].type == VECLISP_PAIR || lambda_head.as.pair[0].type == VECLISP_INT)) {
     if (lambda_tail.type == VECLISP_PAIR) {
       if (lambda_tail.as.pair != NULL) {
         lambda_tail.as.pair = veclisp_alloc_pair();
@@ -1238,6 +2314,7 @@ int veclisp_n_call(struct veclisp_scope *scope, struct veclisp_cell args, struct
           if (a->as.pair[1].type != VECLISP_PAIR) {
             if (veclisp_eval(scope, a->as.pair[1], &t->as.pair[1])) return 1;
           } else if (a->as.pair[1].as.pair != NULL) {
+            t->as.pair[1].as.pair = veclisp_alloc_pair();
             t = &t->as.pair[1];
           } else {
             t->as.pair[1].as.pair = NULL;
@@ -1248,11 +2325,97 @@ int veclisp_n_call(struct veclisp_scope *scope, struct veclisp_cell args, struct
   }
   return veclisp_lambda(scope, lambda_head, lambda_tail, result);
 }
-int veclisp_lambda(struct veclisp_scope *parent_scope, struct veclisp_cell lambda, struct veclisp_cell args, struct veclisp_cell *result) {
+/* looks up the head of the call form site, as n_call does. nonzero when
+   the head takes its arguments evaluated. */
+int veclisp_call_head(struct veclisp_scope *scope, struct veclisp_cell *site, struct veclisp_cell *head) {
+  veclisp_call_lookup(scope, site, head);
+  return head->type == VECLISP_PAIR && head->as.pair != NULL
+    && (head->as.pair[0].type == VECLISP_PAIR || head->as.pair[0].type == VECLISP_INT);
+}
+/* links the n values in args into a list of pairs in cells, which has
+   room for 2n */
+struct veclisp_cell veclisp_call_list(struct veclisp_cell *cells, struct veclisp_cell *args, int64_t n) {
+  struct veclisp_cell list;
+  int64_t i;
+  list.type = VECLISP_PAIR;
+  list.as.pair = n > 0 ? cells : NULL;
+  for (i = 0; i < n; ++i) {
+    cells[2 * i] = args[i];
+    cells[2 * i + 1].type = VECLISP_PAIR;
+    cells[2 * i + 1].as.pair = i + 1 < n ? &cells[2 * i + 2] : NULL;
+  }
+  return list;
+}
+/* calls head with the n evaluated arguments in args. a lambda with a
+   list of names copies its arguments into its frame, so their list can
+   live on the C stack. */
+int veclisp_call_apply(struct veclisp_scope *scope, struct veclisp_cell *head, struct veclisp_cell *args, int64_t n, struct veclisp_cell *result) {
+  struct veclisp_cell cells[2 * VECLISP_FRAME_SLOTS], *p = cells;
+  if (n > 0 && (head->as.pair[0].type != VECLISP_PAIR || n > VECLISP_FRAME_SLOTS)) p = GC_malloc(sizeof(*p) * 2 * n);
+  return veclisp_lambda(scope, *head, veclisp_call_list(p, args, n), result);
+}
+/* the rest of n_call, for a head taking its arguments unevaluated */
+int veclisp_call_rest(struct veclisp_scope *scope, struct veclisp_cell *head, struct veclisp_cell *site, struct veclisp_cell *result) {
+  if (head->type == VECLISP_PAIR && head->as.pair == NULL) {
+    *result = site[0];
+    return 1;
+  }
+  return veclisp_lambda(scope, *head, site[1], result);
+}
+/* nonzero while every guarded symbol is bound only globally, to the
+   value it had when the guard was taken */
+int veclisp_guards_hold(struct veclisp_guard *guards, int64_t n) {
+  int64_t i;
+  for (i = 0; i < n; ++i) {
+    if ((((unsigned char *)guards[i].sym)[-1] & VECLISP_SYM_SHADOWED) || guards[i].binding == NULL
+        || guards[i].binding->value.type != VECLISP_INT || guards[i].binding->value.as.integer != guards[i].value)
+      return 0;
+  }
+  return 1;
+}
+/* guards that the global bindings of syms in root are still natives */
+struct veclisp_guard *veclisp_guard_natives(struct veclisp_scope *root, const char **syms, veclisp_native_func *natives, int64_t n) {
+  struct veclisp_guard *guards = GC_malloc(sizeof(*guards) * n);
+  int64_t i;
+  for (i = 0; i < n; ++i) {
+    guards[i].sym = veclisp_intern(syms[i]);
+    guards[i].binding = veclisp_scope_binding(root, guards[i].sym);
+    guards[i].value = (int64_t)natives[i];
+  }
+  return guards;
+}
+/* binds the n names to the elements of args in the frame b, as a
+   lambda with a list of names does */
+void veclisp_bind_args(struct veclisp_bindings *b, char **names, int64_t n, struct veclisp_cell args) {
+  struct veclisp_cell *a = &args;
+  int64_t i;
+  for (i = 0; i < n; ++i) {
+    b[i].sym = names[i];
+    b[i].next = i + 1 < n ? &b[i + 1] : NULL;
+    if (a->type != VECLISP_PAIR || a->as.pair == NULL) b[i].value = *a;
+    else {
+      b[i].value = a->as.pair[0];
+      a = &a->as.pair[1];
+    }
+  }
+}
+/* a frame's bindings sit side by side, linked in order so lookups walk
+   them like any other scope. up to VECLISP_FRAME_SLOTS live in the
+   caller's inline array. */
+struct veclisp_bindings *veclisp_frame(struct veclisp_bindings *inline_slots, int64_t n) {
   int64_t i;
-  struct veclisp_cell *a, *p;
+  struct veclisp_bindings *slots = inline_slots;
+  if (n > VECLISP_FRAME_SLOTS) slots = GC_malloc(sizeof(*slots) * n);
+  for (i = 0; i < n - 1; ++i) slots[i].next = &slots[i + 1];
+  slots[n - 1].next = NULL;
+  return slots;
+}
+int veclisp_lambda(struct veclisp_scope *parent_scope, struct veclisp_cell lambda, struct veclisp_cell args, struct veclisp_cell *result) {
+  int64_t i, n;
+  struct veclisp_cell *a, *p, *names;
   struct veclisp_scope scope;
-  struct veclisp_bindings bindings, *b;
+  struct veclisp_bindings slots[VECLISP_FRAME_SLOTS], *b;
+  veclisp_jit_func jit;
  retry:
   switch (lambda.type) {
   case VECLISP_VEC:
@@ -1270,14 +2433,22 @@ int veclisp_lambda(struct veclisp_scope *parent_scope, struct veclisp_cell lambd
       result->as.sym = VECLISP_ERR_ILLEGAL_LAMBDA_LIST;
       return 1;
     }
+    break;
+  default:
+    result->type = VECLISP_SYM;
+    result->as.sym = VECLISP_ERR_ILLEGAL_LAMBDA_LIST;
+    return 1;
   }
   scope.bindings = NULL;
   switch (lambda.as.pair[0].type) {
+  case VECLISP_INT:
+    return ((veclisp_closure_func)lambda.as.pair[0].as.integer)(parent_scope, lambda.as.pair[1], args, result);
   case VECLISP_SYM:
-    scope.bindings = &bindings;
-    bindings.sym = lambda.as.pair[0].as.sym;
-    bindings.value = args;
-    bindings.next = NULL;
+    scope.bindings = slots;
+    slots[0].sym = lambda.as.pair[0].as.sym;
+    veclisp_rebind_local(slots[0].sym);
+    slots[0].value = args;
+    slots[0].next = NULL;
     break;
   case VECLISP_PAIR:
     a = &args;
@@ -1286,17 +2457,17 @@ int veclisp_lambda(struct veclisp_scope *parent_scope, struct veclisp_cell lambd
       result->as.sym = VECLISP_ERR_ILLEGAL_LAMBDA_LIST;
       return 1;
     }
+    n = 0;
+    FORPAIR(p, &lambda.as.pair[0]) ++n;
+    b = scope.bindings = veclisp_frame(slots, n);
     FORPAIR(p, &lambda.as.pair[0]) {
-      if (!scope.bindings) {
-        scope.bindings = &bindings;
-        b = &bindings;
-      }
       if (p->as.pair[0].type != VECLISP_SYM) {
         result->type = VECLISP_SYM;
         result->as.sym = VECLISP_ERR_INVALID_NAME;
         return 1;
       }
       b->sym = p->as.pair[0].as.sym;
+      veclisp_rebind_local(b->sym);
       if (a->type == VECLISP_PAIR) {
         if (a->as.pair == NULL) {
           b->value.type = VECLISP_PAIR;
@@ -1308,27 +2479,22 @@ int veclisp_lambda(struct veclisp_scope *parent_scope, struct veclisp_cell lambd
       } else {
         b->value = *a;
       }
-      if (p->as.pair[1].as.pair == NULL) {
-        b->next = NULL;
-      } else {
-        b->next = GC_malloc(sizeof(*b->next));
-        b = b->next;
-      }
+      ++b;
     }
     break;
   case VECLISP_VEC:
     a = &args;
-    FORVEC(i, lambda.as.pair[0].as.vec) {
-      if (!scope.bindings) {
-        scope.bindings = &bindings;
-        b = &bindings;
-      }
-      if (lambda.as.pair[0].as.vec[i].type != VECLISP_SYM) {
+    names = lambda.as.pair[0].as.vec;
+    if (VECLISP_VLEN(names) == 0) break;
+    b = scope.bindings = veclisp_frame(slots, VECLISP_VLEN(names));
+    FORVEC(i, names) {
+      if (VECLISP_VELEMS(names)[i].type != VECLISP_SYM) {
         result->type = VECLISP_SYM;
         result->as.sym = VECLISP_ERR_INVALID_NAME;
         return 1;
       }
-      b->sym = lambda.as.pair[0].as.vec[i].as.sym;
+      b->sym = VECLISP_VELEMS(names)[i].as.sym;
+      veclisp_rebind_local(b->sym);
       if (a->as.pair == NULL) {
         b->value.type = VECLISP_PAIR;
         b->value.as.pair = NULL;
@@ -1336,12 +2502,7 @@ int veclisp_lambda(struct veclisp_scope *parent_scope, struct veclisp_cell lambd
         b->value = a->as.pair[0];
         a = &a->as.pair[1];
       }
-      if (i == lambda.as.pair[0].as.vec[0].as.integer) {
-        b->next = NULL;
-      } else {
-        b->next = GC_malloc(sizeof(*b->next));
-        b = b->next;
-      }
+      ++b;
     }
     break;
   default:
@@ -1350,38 +2511,58 @@ int veclisp_lambda(struct veclisp_scope *parent_scope, struct veclisp_cell lambd
     return 1;
   }
   scope.next = parent_scope;
+  if (veclisp_current->jit_threshold > 0 && lambda.as.pair[0].type == VECLISP_PAIR
+      && (jit = veclisp_jit_entry(lambda)) != NULL)
+    return jit(&scope, scope.bindings, result);
   FORPAIR(p, &lambda.as.pair[1]) {
     if (veclisp_eval(&scope, p->as.pair[0], result)) return 1;
   }
   return 0;
 }
-int veclisp_n_load(struct veclisp_scope *scope, struct veclisp_cell args, struct veclisp_cell *result) {
-  FILE *in;
-  struct veclisp_cell infile, last_read;
+/* evaluates every form read from in, with *In bound to it, stopping at
+   the first error. echo writes each result as the repl would. */
+int veclisp_load_stream(struct veclisp_scope *scope, FILE *in, int echo, struct veclisp_cell *result) {
+  struct veclisp_cell last_read;
   struct veclisp_scope load_scope;
-  struct veclisp_bindings load_bindings;
-  if (veclisp_eval(scope, args.as.pair[0], &infile)) return 1;
-  if (infile.type != VECLISP_SYM) {
-    result->type = VECLISP_SYM;
-    result->as.sym = VECLISP_ERR_INVALID_NAME;
-    return 1;
-  }
+  struct veclisp_bindings load_bindings[2];
   load_scope.next = scope;
-  load_scope.bindings = &load_bindings;
-  load_bindings.next = NULL;
-  load_bindings.sym = VECLISP_INPORT;
-  load_bindings.value.type = VECLISP_INT;
-  load_bindings.value.as.integer = (int64_t)(in = fopen(infile.as.sym, "r"));
+  load_scope.bindings = load_bindings;
+  load_bindings[0].next = &load_bindings[1];
+  load_bindings[0].sym = VECLISP_INPORT;
+  load_bindings[0].value.type = VECLISP_INT;
+  load_bindings[0].value.as.integer = (int64_t)in;
+  load_bindings[1].next = NULL;
+  load_bindings[1].sym = VECLISP_LEXICAL;
+  load_bindings[1].value = veclisp_nil();
   for (;;) {
     if (veclisp_read(&load_scope, &last_read)) {
       if (last_read.type == VECLISP_INT && last_read.as.integer == EOF) break;
       *result = last_read;
       return 1;
-    } else if (veclisp_eval(&load_scope, last_read, result)) return 1;
+    }
+    if (load_bindings[1].value.type != VECLISP_PAIR || load_bindings[1].value.as.pair != NULL) {
+      if (veclisp_lex_define(&last_read, result)) return 1;
+    }
+    if (veclisp_eval(&load_scope, last_read, result)) return 1;
+    if (echo) veclisp_write_result(&load_scope, *result);
   }
-  fclose(in);
   return 0;
 }
+int veclisp_n_load(struct veclisp_scope *scope, struct veclisp_cell args, struct veclisp_cell *result) {
+  FILE *in;
+  struct veclisp_cell infile;
+  int failed;
+  if (veclisp_eval(scope, args.as.pair[0], &infile)) return 1;
+  if (infile.type != VECLISP_SYM) {
+    result->type = VECLISP_SYM;
+    result->as.sym = VECLISP_ERR_INVALID_NAME;
+    return 1;
+  }
+  if ((in = fopen(infile.as.sym, "r")) == NULL) return veclisp_errno_err(result);
+  failed = veclisp_load_stream(scope, in, 0, result);
+  fclose(in);
+  return failed;
+}
 int veclisp_n_macro(struct veclisp_scope *scope, struct veclisp_cell args, struct veclisp_cell *result) {
   struct veclisp_cell *a, *l, list;
   list.type = VECLISP_PAIR;
@@ -1441,12 +2622,11 @@ int veclisp_n_map(struct veclisp_scope *scope, struct veclisp_cell args, struct
   switch (seq.type) {
   case VECLISP_VEC:
     result->type = VECLISP_VEC;
-    result->as.vec = GC_malloc(sizeof(*result->as.vec) * (1 + seq.as.vec[0].as.integer));
-    result->as.vec[0] = seq.as.vec[0];
+    result->as.vec = veclisp_alloc_vec(VECLISP_VLEN(seq.as.vec));
     FORVEC(i, seq.as.vec) {
       fun_args.type = VECLISP_PAIR;
       fun_args.as.pair = veclisp_alloc_pair();
-      fun_args.as.pair[0] = seq.as.vec[i];
+      fun_args.as.pair[0] = VECLISP_VELEMS(seq.as.vec)[i];
       fun_args.as.pair[1].type = VECLISP_PAIR;
       fun_args.as.pair[1].as.pair = NULL;
       if (veclisp_lambda(scope, fun, fun_args, &result->as.vec[i])) return 1;
@@ -1468,7 +2648,9 @@ int veclisp_n_map(struct veclisp_scope *scope, struct veclisp_cell args, struct
       fun_args.as.pair[1].as.pair = NULL;
       if (veclisp_lambda(scope, fun, fun_args, &r->as.pair[0])) return 1;
       r->as.pair[1].type = VECLISP_PAIR;
-      if (s->as.pair[1].type != VECLISP_PAIR) {
+      if (s->as.pair[1].type == VECLISP_LAZY) {
+        return veclisp_lazy_map(VECLISP_LAZY_MAP, fun, s->as.pair[1], &r->as.pair[1]);
+      } else if (s->as.pair[1].type != VECLISP_PAIR) {
         fun_args.as.pair = veclisp_alloc_pair();
         fun_args.as.pair[0] = s->as.pair[1];
         fun_args.as.pair[1].type = VECLISP_PAIR;
@@ -1482,6 +2664,8 @@ int veclisp_n_map(struct veclisp_scope *scope, struct veclisp_cell args, struct
       }
     }
     return 0;
+  case VECLISP_LAZY:
+    return veclisp_lazy_map(VECLISP_LAZY_MAP, fun, seq, result);
   default:
   case VECLISP_INT:
   case VECLISP_SYM:
@@ -1499,20 +2683,19 @@ int veclisp_n_filter(struct veclisp_scope *scope, struct veclisp_cell args, stru
   if (veclisp_eval(scope, args.as.pair[1].as.pair[0], &seq)) return 1;
   switch (seq.type) {
   case VECLISP_VEC:
-    vec_allocated = 1 + seq.as.vec[0].as.integer;
-    vec_used = 0;
+    vec_allocated = 1 + VECLISP_VLEN(seq.as.vec);
+    vec_used = 1;
     result->type = VECLISP_VEC;
-    result->as.vec = GC_malloc(sizeof(*result->as.vec) * vec_allocated);
-    result->as.vec[vec_used++] = seq.as.vec[0];
+    result->as.vec = veclisp_alloc_vec(vec_allocated - 1);
     FORVEC(i, seq.as.vec) {
       fun_args.type = VECLISP_PAIR;
       fun_args.as.pair = veclisp_alloc_pair();
-      fun_args.as.pair[0] = seq.as.vec[i];
+      fun_args.as.pair[0] = VECLISP_VELEMS(seq.as.vec)[i];
       fun_args.as.pair[1].type = VECLISP_PAIR;
       fun_args.as.pair[1].as.pair = NULL;
       if (veclisp_lambda(scope, fun, fun_args, &result->as.vec[vec_used])) return 1;
       if (result->as.vec[vec_used].type != VECLISP_PAIR || result->as.vec[vec_used].as.pair != NULL) {
-        result->as.vec[vec_used++] = seq.as.vec[i];
+        result->as.vec[vec_used++] = VECLISP_VELEMS(seq.as.vec)[i];
       }
     }
     result->as.vec[0].as.integer = vec_used - 1;
@@ -1540,7 +2723,9 @@ int veclisp_n_filter(struct veclisp_scope *scope, struct veclisp_cell args, stru
         r->as.pair[1].as.pair = NULL;
         r = &r->as.pair[1];
       }
-      if (s->as.pair[1].type != VECLISP_PAIR) {
+      if (s->as.pair[1].type == VECLISP_LAZY) {
+        return veclisp_lazy_map(VECLISP_LAZY_FILTER, fun, s->as.pair[1], r);
+      } else if (s->as.pair[1].type != VECLISP_PAIR) {
         fun_args.as.pair = veclisp_alloc_pair();
         fun_args.as.pair[0] = s->as.pair[1];
         fun_args.as.pair[1].type = VECLISP_PAIR;
@@ -1552,6 +2737,8 @@ int veclisp_n_filter(struct veclisp_scope *scope, struct veclisp_cell args, stru
       }
     }
     return 0;
+  case VECLISP_LAZY:
+    return veclisp_lazy_map(VECLISP_LAZY_FILTER, fun, seq, result);
   default:
   case VECLISP_INT:
   case VECLISP_SYM:
@@ -1561,21 +2748,25 @@ int veclisp_n_filter(struct veclisp_scope *scope, struct veclisp_cell args, stru
   }
 }
 int veclisp_n_let(struct veclisp_scope *scope, struct veclisp_cell args, struct veclisp_cell *result) {
+  int64_t n = 0;
   struct veclisp_cell *a;
   struct veclisp_scope let_scope;
-  struct veclisp_bindings let_bindings, *b;
-  b = let_scope.bindings = &let_bindings;
-  let_bindings.sym = NULL;
-  let_bindings.next = NULL;
+  struct veclisp_bindings slots[VECLISP_FRAME_SLOTS], *b;
+  let_scope.bindings = NULL;
   FORPAIR(a, &args.as.pair[0]) {
-    if (b->sym != NULL) {
-      b->next = GC_malloc(sizeof(*b->next));
-      b = b->next;
-    }
-    b->sym = a->as.pair[0].as.sym;
-    if (veclisp_eval(scope, a->as.pair[1].as.pair[0], &b->value)) return 1;
-    b->next = NULL;
+    ++n;
     a = &a->as.pair[1];
+    if (a->type != VECLISP_PAIR || a->as.pair == NULL) break;
+  }
+  if (n) {
+    b = let_scope.bindings = veclisp_frame(slots, n);
+    FORPAIR(a, &args.as.pair[0]) {
+      b->sym = a->as.pair[0].as.sym;
+      if (a->as.pair[0].type == VECLISP_SYM) veclisp_rebind_local(b->sym);
+      if (veclisp_eval(scope, a->as.pair[1].as.pair[0], &b->value)) return 1;
+      ++b;
+      a = &a->as.pair[1];
+    }
   }
   let_scope.next = scope;
   FORPAIR(a, &args.as.pair[1]) if (veclisp_eval(&let_scope, a->as.pair[0], result)) return 1;
@@ -1597,6 +2788,7 @@ int veclisp_n_catch(struct veclisp_scope *scope, struct veclisp_cell args, struc
   struct veclisp_scope catch_scope;
   struct veclisp_bindings catch_bindings;
   catch_bindings.sym = args.as.pair[0].as.pair[0].as.sym;
+  if (args.as.pair[0].as.pair[0].type == VECLISP_SYM) veclisp_rebind_local(catch_bindings.sym);
   catch_bindings.value.type = VECLISP_PAIR;
   catch_bindings.value.as.pair = NULL;
   catch_bindings.next = NULL;
@@ -1630,8 +2822,12 @@ void veclisp_writebytes(FILE *out, struct veclisp_cell value) {
     }
     break;
   case VECLISP_VEC:
-    FORVEC(i, value.as.vec) veclisp_writebytes(out, value.as.vec[i]);
+    FORVEC(i, value.as.vec) veclisp_writebytes(out, VECLISP_VELEMS(value.as.vec)[i]);
     break;
+  case VECLISP_BYTES:
+    fwrite(value.as.bytes->data, 1, value.as.bytes->length, out);
+    break;
+  default: break;
   }
 }
 int veclisp_n_writebytes(struct veclisp_scope *scope, struct veclisp_cell args, struct veclisp_cell *result) {
@@ -1657,7 +2853,7 @@ void veclisp_print(FILE *out, struct veclisp_cell value) {
     fputs(value.as.sym, out);
     break;
   case VECLISP_VEC:
-    FORVEC(i, value.as.vec) veclisp_print(out, value.as.vec[i]);
+    FORVEC(i, value.as.vec) veclisp_print(out, VECLISP_VELEMS(value.as.vec)[i]);
     break;
   case VECLISP_PAIR:
     FORPAIR(v, &value) {
@@ -1665,6 +2861,15 @@ void veclisp_print(FILE *out, struct veclisp_cell value) {
       if (v->as.pair[1].type != VECLISP_PAIR) veclisp_print(out, v->as.pair[1]);
     }
     break;
+  case VECLISP_LAZY:
+    fputs("#lazy", out);
+    break;
+  case VECLISP_CHAN:
+    fputs("#chan", out);
+    break;
+  case VECLISP_BYTES:
+    fwrite(value.as.bytes->data, 1, value.as.bytes->length, out);
+    break;
   }
 }
 int veclisp_n_print(struct veclisp_scope *scope, struct veclisp_cell args, struct veclisp_cell *result) {
@@ -1722,9 +2927,18 @@ char *veclisp_pack(struct veclisp_cell value, int64_t *used, int64_t *allocated,
     return veclisp_pack(value.as.pair[1], used, allocated, sym);
   case VECLISP_VEC:
     FORVEC(i, value.as.vec) {
-      sym = veclisp_pack(value.as.vec[i], used, allocated, sym);
+      sym = veclisp_pack(VECLISP_VELEMS(value.as.vec)[i], used, allocated, sym);
+    }
+    return sym;
+  case VECLISP_BYTES:
+    while (*used + value.as.bytes->length >= *allocated) {
+      *allocated *= 2;
+      sym = GC_realloc(sym, sizeof(*sym) * (*allocated));
     }
+    memcpy(sym + *used, value.as.bytes->data, value.as.bytes->length);
+    *used += value.as.bytes->length;
     return sym;
+  default: return sym;
   }
   return NULL;
 }
@@ -1742,7 +2956,7 @@ int veclisp_n_pack(struct veclisp_scope *scope, struct veclisp_cell args, struct
   return 0;
 }
 int veclisp_n_fold(struct veclisp_scope *scope, struct veclisp_cell args, struct veclisp_cell *nil) {
-  int64_t i;
+  int64_t i, start, end, step;
   struct veclisp_cell cons, seq, cons_args, *s;
   if (veclisp_eval(scope, args.as.pair[0], &cons)) {
     *nil = cons;
@@ -1756,6 +2970,7 @@ int veclisp_n_fold(struct veclisp_scope *scope, struct veclisp_cell args, struct
   switch (seq.type) {
   case VECLISP_INT:
   case VECLISP_SYM:
+  case VECLISP_CHAN:
     nil->type = VECLISP_SYM;
     nil->as.sym = VECLISP_ERR_INVALID_SEQUENCE;
     return 1;
@@ -1771,12 +2986,38 @@ int veclisp_n_fold(struct veclisp_scope *scope, struct veclisp_cell args, struct
       cons_args.as.pair[1].as.pair[1].as.pair = NULL;
       if (veclisp_lambda(scope, cons, cons_args, nil)) return 1;
     }
+    if (s->type != VECLISP_LAZY) return 0;
+    seq = *s;
+  case VECLISP_LAZY:
+    if (veclisp_range_bounds(seq, &start, &end, &step)) {
+      cons_args.type = VECLISP_INT;
+      for (i = start; step > 0 ? i < end : i > end; i += step) {
+        cons_args.as.integer = i;
+        if (veclisp_apply2(scope, cons, cons_args, *nil, nil)) return 1;
+      }
+      return 0;
+    }
+    for (;;) {
+      if (veclisp_force(scope, seq, &seq)) {
+        *nil = seq;
+        return 1;
+      }
+      if (seq.type != VECLISP_PAIR || seq.as.pair == NULL) return 0;
+      if (veclisp_apply2(scope, cons, seq.as.pair[0], *nil, nil)) return 1;
+      seq = seq.as.pair[1];
+    }
+  case VECLISP_BYTES:
+    cons_args.type = VECLISP_INT;
+    for (i = 0; i < seq.as.bytes->length; ++i) {
+      cons_args.as.integer = seq.as.bytes->data[i];
+      if (veclisp_apply2(scope, cons, cons_args, *nil, nil)) return 1;
+    }
     return 0;
   case VECLISP_VEC:
     FORVEC(i, seq.as.vec) {
       cons_args.type = VECLISP_PAIR;
       cons_args.as.pair = veclisp_alloc_pair();
-      cons_args.as.pair[0] = seq.as.vec[i];
+      cons_args.as.pair[0] = VECLISP_VELEMS(seq.as.vec)[i];
       cons_args.as.pair[1].type = VECLISP_PAIR;
       cons_args.as.pair[1].as.pair = veclisp_alloc_pair();
       cons_args.as.pair[1].as.pair[0] = *nil;
@@ -1898,6 +3139,7 @@ int veclisp_n_find(struct veclisp_scope *scope, struct veclisp_cell args, struct
   switch (seq.type) {
   case VECLISP_INT:
   case VECLISP_SYM:
+  case VECLISP_CHAN:
     result->type = VECLISP_SYM;
     result->as.sym = VECLISP_ERR_INVALID_SEQUENCE;
     return 1;
@@ -1916,20 +3158,55 @@ int veclisp_n_find(struct veclisp_scope *scope, struct veclisp_cell args, struct
         return 0;
       }
     }
-    return 0;
+    if (s->type != VECLISP_LAZY) return 0;
+    seq = *s;
+  case VECLISP_LAZY:
+    for (;;) {
+      if (veclisp_force(scope, seq, result)) return 1;
+      if (result->type != VECLISP_PAIR || result->as.pair == NULL) {
+        result->type = VECLISP_PAIR;
+        result->as.pair = NULL;
+        return 0;
+      }
+      if (veclisp_apply1(scope, p, result->as.pair[0], &t)) {
+        *result = t;
+        return 1;
+      }
+      if (!(t.type == VECLISP_PAIR && t.as.pair == NULL)) return 0;
+      seq = result->as.pair[1];
+    }
   case VECLISP_VEC:
     result->type = VECLISP_PAIR;
     result->as.pair = NULL;
     FORVEC(i, seq.as.vec) {
       args.type = VECLISP_PAIR;
       args.as.pair = call_args;
-      call_args[0] = seq.as.vec[i];
+      call_args[0] = VECLISP_VELEMS(seq.as.vec)[i];
       call_args[1].type = VECLISP_PAIR;
       call_args[1].as.pair = NULL;
       if (veclisp_lambda(scope, p, args, &t)) return 1;
       if (!(t.type == VECLISP_PAIR && t.as.pair == NULL)) {
         result->as.pair = veclisp_alloc_pair();
-        result->as.pair[0] = seq.as.vec[i];
+        result->as.pair[0] = VECLISP_VELEMS(seq.as.vec)[i];
+        result->as.pair[1].type = VECLISP_INT;
+        result->as.pair[1].as.integer = i;
+        return 0;
+      }
+    }
+    return 0;
+  case VECLISP_BYTES:
+    result->type = VECLISP_PAIR;
+    result->as.pair = NULL;
+    call_args[0].type = VECLISP_INT;
+    for (i = 0; i < seq.as.bytes->length; ++i) {
+      call_args[0].as.integer = seq.as.bytes->data[i];
+      if (veclisp_apply1(scope, p, call_args[0], &t)) {
+        *result = t;
+        return 1;
+      }
+      if (!(t.type == VECLISP_PAIR && t.as.pair == NULL)) {
+        result->as.pair = veclisp_alloc_pair();
+        result->as.pair[0] = call_args[0];
         result->as.pair[1].type = VECLISP_INT;
         result->as.pair[1].as.integer = i;
         return 0;
@@ -1956,11 +3233,3666 @@ int veclisp_n_if(struct veclisp_scope *scope, struct veclisp_cell args, struct v
   } else return veclisp_eval(&if_scope, args.as.pair[1].as.pair[0], result);
   return 0;
 }
-/*
-  int veclisp_n_bytes(struct veclisp_scope *scope, struct veclisp_cell args, struct veclisp_cell *result) {
+int veclisp_apply1(struct veclisp_scope *scope, struct veclisp_cell fun, struct veclisp_cell x, struct veclisp_cell *result) {
+  struct veclisp_cell args, call_args[2];
+  args.type = VECLISP_PAIR;
+  args.as.pair = call_args;
+  call_args[0] = x;
+  call_args[1].type = VECLISP_PAIR;
+  call_args[1].as.pair = NULL;
+  return veclisp_lambda(scope, fun, args, result);
+}
+int veclisp_apply2(struct veclisp_scope *scope, struct veclisp_cell fun, struct veclisp_cell x, struct veclisp_cell y, struct veclisp_cell *result) {
+  struct veclisp_cell args, call_args[4];
+  args.type = VECLISP_PAIR;
+  args.as.pair = call_args;
+  call_args[0] = x;
+  call_args[1].type = VECLISP_PAIR;
+  call_args[1].as.pair = &call_args[2];
+  call_args[2] = y;
+  call_args[3].type = VECLISP_PAIR;
+  call_args[3].as.pair = NULL;
+  return veclisp_lambda(scope, fun, args, result);
+}
+struct veclisp_lazy *veclisp_alloc_lazy(int kind) {
+  struct veclisp_lazy *l = GC_malloc(sizeof(*l));
+  l->kind = kind;
+  return l;
+}
+int veclisp_lazy_map(int kind, struct veclisp_cell fun, struct veclisp_cell source, struct veclisp_cell *result) {
+  struct veclisp_lazy *l = veclisp_alloc_lazy(kind);
+  if (kind == VECLISP_LAZY_MAP) l->fun = fun;
+  else l->pred = fun;
+  l->seed = source;
+  result->type = VECLISP_LAZY;
+  result->as.lazy = l;
+  return 0;
+}
+/* forcing a lazy sequence yields () or a pair whose tail is again lazy.
+   the result is remembered, so each element is computed only once. */
+int veclisp_force(struct veclisp_scope *scope, struct veclisp_cell value, struct veclisp_cell *result) {
+  struct veclisp_lazy *l, *next;
+  struct veclisp_cell source, t;
+  struct veclisp_scope read_scope;
+  struct veclisp_bindings read_bindings;
+  if (value.type != VECLISP_LAZY) {
+    *result = value;
+    return 0;
+  }
+  l = value.as.lazy;
+  switch (l->kind) {
+  case VECLISP_LAZY_FORCED:
+    *result = l->value;
+    return 0;
+  case VECLISP_LAZY_UNFOLD:
+    if (veclisp_apply1(scope, l->pred, l->seed, &t)) {
+      *result = t;
+      return 1;
+    }
+    result->type = VECLISP_PAIR;
+    if (!(t.type == VECLISP_PAIR && t.as.pair == NULL)) {
+      result->as.pair = NULL;
+      break;
+    }
+    next = veclisp_alloc_lazy(VECLISP_LAZY_UNFOLD);
+    next->pred = l->pred;
+    next->fun = l->fun;
+    next->step = l->step;
+    if (veclisp_apply1(scope, l->fun, l->seed, &t)) {
+      *result = t;
+      return 1;
+    }
+    if (veclisp_apply1(scope, l->step, l->seed, &next->seed)) {
+      *result = next->seed;
+      return 1;
+    }
+    result->as.pair = veclisp_alloc_pair();
+    result->as.pair[0] = t;
+    result->as.pair[1].type = VECLISP_LAZY;
+    result->as.pair[1].as.lazy = next;
+    break;
+  case VECLISP_LAZY_MAP:
+    if (veclisp_force(scope, l->seed, &source)) {
+      *result = source;
+      return 1;
+    }
+    result->type = VECLISP_PAIR;
+    if (source.type != VECLISP_PAIR || source.as.pair == NULL) {
+      result->as.pair = NULL;
+      break;
+    }
+    result->as.pair = veclisp_alloc_pair();
+    if (veclisp_apply1(scope, l->fun, source.as.pair[0], &result->as.pair[0])) {
+      *result = result->as.pair[0];
+      return 1;
+    }
+    veclisp_lazy_map(VECLISP_LAZY_MAP, l->fun, source.as.pair[1], &result->as.pair[1]);
+    break;
+  case VECLISP_LAZY_FILTER:
+    source = l->seed;
+    for (;;) {
+      if (veclisp_force(scope, source, &source)) {
+        *result = source;
+        return 1;
+      }
+      result->type = VECLISP_PAIR;
+      if (source.type != VECLISP_PAIR || source.as.pair == NULL) {
+        result->as.pair = NULL;
+        break;
+      }
+      if (veclisp_apply1(scope, l->pred, source.as.pair[0], &t)) {
+        *result = t;
+        return 1;
+      }
+      if (!(t.type == VECLISP_PAIR && t.as.pair == NULL)) {
+        result->as.pair = veclisp_alloc_pair();
+        result->as.pair[0] = source.as.pair[0];
+        veclisp_lazy_map(VECLISP_LAZY_FILTER, l->pred, source.as.pair[1], &result->as.pair[1]);
+        break;
+      }
+      source = source.as.pair[1];
+    }
+    break;
+  case VECLISP_LAZY_READ:
+    read_scope.bindings = &read_bindings;
+    read_scope.next = scope;
+    read_bindings.sym = VECLISP_INPORT;
+    read_bindings.value = l->seed;
+    read_bindings.next = NULL;
+    if (veclisp_read(&read_scope, &t)) {
+      if (!(t.type == VECLISP_INT && t.as.integer == EOF)) {
+        *result = t;
+        return 1;
+      }
+      result->type = VECLISP_PAIR;
+      result->as.pair = NULL;
+      break;
+    }
+    next = veclisp_alloc_lazy(VECLISP_LAZY_READ);
+    next->seed = l->seed;
+    result->type = VECLISP_PAIR;
+    result->as.pair = veclisp_alloc_pair();
+    result->as.pair[0] = t;
+    result->as.pair[1].type = VECLISP_LAZY;
+    result->as.pair[1].as.lazy = next;
+    break;
+  case VECLISP_LAZY_RANGE:
+    result->type = VECLISP_PAIR;
+    if (l->step.as.integer > 0 ? l->seed.as.integer >= l->pred.as.integer : l->seed.as.integer <= l->pred.as.integer) {
+      result->as.pair = NULL;
+      break;
+    }
+    next = veclisp_alloc_lazy(VECLISP_LAZY_RANGE);
+    next->seed.type = next->pred.type = next->step.type = VECLISP_INT;
+    next->seed.as.integer = l->seed.as.integer + l->step.as.integer;
+    next->pred = l->pred;
+    next->step = l->step;
+    result->as.pair = veclisp_alloc_pair();
+    result->as.pair[0] = l->seed;
+    result->as.pair[1].type = VECLISP_LAZY;
+    result->as.pair[1].as.lazy = next;
+    break;
+  }
+  l->kind = VECLISP_LAZY_FORCED;
+  l->value = *result;
+  l->fun.type = l->pred.type = l->step.type = l->seed.type = VECLISP_INT;
+  return 0;
+}
+int veclisp_n_lazyunfold(struct veclisp_scope *scope, struct veclisp_cell args, struct veclisp_cell *result) {
+  struct veclisp_lazy *l = veclisp_alloc_lazy(VECLISP_LAZY_UNFOLD);
+  if (veclisp_eval(scope, args.as.pair[0], &l->pred)
+      || veclisp_eval(scope, args.as.pair[1].as.pair[0], &l->fun)
+      || veclisp_eval(scope, args.as.pair[1].as.pair[1].as.pair[0], &l->step)
+      || veclisp_eval(scope, args.as.pair[1].as.pair[1].as.pair[1].as.pair[0], &l->seed)) {
+    return 1;
+  }
+  result->type = VECLISP_LAZY;
+  result->as.lazy = l;
+  return 0;
+}
+int veclisp_n_lazyread(struct veclisp_scope *scope, struct veclisp_cell args, struct veclisp_cell *result) {
+  struct veclisp_lazy *l = veclisp_alloc_lazy(VECLISP_LAZY_READ);
+  if (args.type == VECLISP_PAIR && args.as.pair != NULL) {
+    if (veclisp_eval(scope, args.as.pair[0], &l->seed)) return 1;
+  } else if (veclisp_scope_lookup(scope, VECLISP_INPORT, &l->seed)) {
+    l->seed.type = VECLISP_INT;
+    l->seed.as.integer = (int64_t)stdin;
+  }
+  if (l->seed.type != VECLISP_INT) {
+    result->type = VECLISP_SYM;
+    result->as.sym = VECLISP_ERR_EXPECTED_INT;
+    return 1;
+  }
+  result->type = VECLISP_LAZY;
+  result->as.lazy = l;
+  return 0;
+}
+/* push one element through every stage of a pipe. nothing is allocated
+   here unless the pipe collects its output. */
+int veclisp_pipe_push(struct veclisp_scope *scope, struct veclisp_pipe *pipe, struct veclisp_cell x) {
+  int64_t i;
+  struct veclisp_pipe_stage *stage;
+  struct veclisp_cell t;
+  for (i = 0; i < pipe->stage_count; ++i) {
+    stage = &pipe->stages[i];
+    switch (stage->kind) {
+    case VECLISP_STAGE_MAP:
+      if (veclisp_apply1(scope, stage->fun, x, &x)) {
+        pipe->acc = x;
+        return 1;
+      }
+      break;
+    case VECLISP_STAGE_FILTER:
+      if (veclisp_apply1(scope, stage->fun, x, &t)) {
+        pipe->acc = t;
+        return 1;
+      }
+      if (t.type == VECLISP_PAIR && t.as.pair == NULL) return 0;
+      break;
+    case VECLISP_STAGE_TAKE:
+      if (stage->n <= 0) {
+        pipe->done = 1;
+        return 0;
+      }
+      if (--stage->n == 0) pipe->done = 1;
+      break;
+    case VECLISP_STAGE_DROP:
+      if (stage->n > 0) {
+        stage->n--;
+        return 0;
+      }
+      break;
+    case VECLISP_STAGE_FOLD:
+      return veclisp_apply2(scope, stage->fun, x, pipe->acc, &pipe->acc);
+    }
+  }
+  if (pipe->tail != NULL) {
+    pipe->tail->type = VECLISP_PAIR;
+    pipe->tail->as.pair = veclisp_alloc_pair();
+    pipe->tail->as.pair[0] = x;
+    pipe->tail = &pipe->tail->as.pair[1];
+    pipe->tail->type = VECLISP_PAIR;
+    pipe->tail->as.pair = NULL;
+  } else {
+    if (pipe->used >= pipe->allocated) {
+      pipe->allocated *= 2;
+      pipe->acc.as.vec = GC_realloc(pipe->acc.as.vec, sizeof(*pipe->acc.as.vec) * pipe->allocated);
+    }
+    pipe->acc.as.vec[pipe->used++] = x;
+  }
+  return 0;
+}
+int veclisp_n_pipe(struct veclisp_scope *scope, struct veclisp_cell args, struct veclisp_cell *result) {
+  int64_t i, start, end, step;
+  struct veclisp_cell seq, *a, x;
+  struct veclisp_pipe pipe;
+  struct veclisp_pipe_stage *stage;
+  struct veclisp_scope read_scope;
+  struct veclisp_bindings read_bindings;
+  if (veclisp_eval(scope, args.as.pair[0], &seq)) {
+    *result = seq;
+    return 1;
+  }
+  pipe.stage_count = 0;
+  FORPAIR(a, &args.as.pair[1]) pipe.stage_count++;
+  pipe.stages = GC_malloc(sizeof(*pipe.stages) * (pipe.stage_count + 1));
+  pipe.done = pipe.folding = 0;
+  stage = pipe.stages;
+  FORPAIR(a, &args.as.pair[1]) {
+    x = a->as.pair[0];
+    if (pipe.folding || x.type != VECLISP_PAIR || x.as.pair == NULL || x.as.pair[0].type != VECLISP_SYM
+        || x.as.pair[1].type != VECLISP_PAIR || x.as.pair[1].as.pair == NULL) {
+      result->type = VECLISP_SYM;
+      result->as.sym = VECLISP_ERR_INVALID_STAGE;
+      return 1;
+    }
+    if (x.as.pair[0].as.sym == VECLISP_MAP) stage->kind = VECLISP_STAGE_MAP;
+    else if (x.as.pair[0].as.sym == VECLISP_FILTER) stage->kind = VECLISP_STAGE_FILTER;
+    else if (x.as.pair[0].as.sym == VECLISP_TAKE) stage->kind = VECLISP_STAGE_TAKE;
+    else if (x.as.pair[0].as.sym == VECLISP_DROP) stage->kind = VECLISP_STAGE_DROP;
+    else if (x.as.pair[0].as.sym == VECLISP_FOLD) stage->kind = pipe.folding = VECLISP_STAGE_FOLD;
+    else {
+      result->type = VECLISP_SYM;
+      result->as.sym = VECLISP_ERR_INVALID_STAGE;
+      return 1;
+    }
+    if (veclisp_eval(scope, x.as.pair[1].as.pair[0], &stage->fun)) {
+      *result = stage->fun;
+      return 1;
+    }
+    if (stage->kind == VECLISP_STAGE_TAKE || stage->kind == VECLISP_STAGE_DROP) {
+      if (stage->fun.type != VECLISP_INT) {
+        result->type = VECLISP_SYM;
+        result->as.sym = VECLISP_ERR_EXPECTED_INT;
+        return 1;
+      }
+      stage->n = stage->fun.as.integer;
+    } else if (stage->kind == VECLISP_STAGE_FOLD) {
+      x = x.as.pair[1].as.pair[1];
+      if (x.type != VECLISP_PAIR || x.as.pair == NULL) {
+        pipe.acc.type = VECLISP_PAIR;
+        pipe.acc.as.pair = NULL;
+      } else if (veclisp_eval(scope, x.as.pair[0], &pipe.acc)) {
+        *result = pipe.acc;
+        return 1;
+      }
+    }
+    stage++;
+  }
+  pipe.tail = NULL;
+  if (!pipe.folding) {
+    if (seq.type == VECLISP_VEC || seq.type == VECLISP_BYTES) {
+      pipe.used = 1;
+      pipe.allocated = 32;
+      pipe.acc.type = VECLISP_VEC;
+      pipe.acc.as.vec = GC_malloc(sizeof(*pipe.acc.as.vec) * pipe.allocated);
+      pipe.acc.as.vec[0].type = VECLISP_INT;
+    } else {
+      pipe.acc.type = VECLISP_PAIR;
+      pipe.acc.as.pair = NULL;
+      pipe.tail = &pipe.acc;
+    }
+  }
+  for (i = 0; i < pipe.stage_count; ++i)
+    if (pipe.stages[i].kind == VECLISP_STAGE_TAKE && pipe.stages[i].n <= 0) pipe.done = 1;
+  switch (seq.type) {
+  case VECLISP_VEC:
+    for (i = 1; !pipe.done && i <= VECLISP_VLEN(seq.as.vec); ++i) {
+      if (veclisp_pipe_push(scope, &pipe, VECLISP_VELEMS(seq.as.vec)[i])) {
+        *result = pipe.acc;
+        return 1;
+      }
+    }
+    break;
+  case VECLISP_BYTES:
+    x.type = VECLISP_INT;
+    for (i = 0; !pipe.done && i < seq.as.bytes->length; ++i) {
+      x.as.integer = seq.as.bytes->data[i];
+      if (veclisp_pipe_push(scope, &pipe, x)) {
+        *result = pipe.acc;
+        return 1;
+      }
+    }
+    break;
+  case VECLISP_LAZY:
+    if (veclisp_range_bounds(seq, &start, &end, &step)) {
+      x.type = VECLISP_INT;
+      for (i = start; !pipe.done && (step > 0 ? i < end : i > end); i += step) {
+        x.as.integer = i;
+        if (veclisp_pipe_push(scope, &pipe, x)) {
+          *result = pipe.acc;
+          return 1;
+        }
+      }
+      break;
+    }
+  case VECLISP_PAIR:
+    while (!pipe.done) {
+      if (veclisp_force(scope, seq, &seq)) {
+        *result = seq;
+        return 1;
+      }
+      if (seq.type != VECLISP_PAIR || seq.as.pair == NULL) break;
+      if (veclisp_pipe_push(scope, &pipe, seq.as.pair[0])) {
+        *result = pipe.acc;
+        return 1;
+      }
+      seq = seq.as.pair[1];
+    }
+    break;
+  case VECLISP_INT:
+    read_scope.bindings = &read_bindings;
+    read_scope.next = scope;
+    read_bindings.sym = VECLISP_INPORT;
+    read_bindings.value = seq;
+    read_bindings.next = NULL;
+    while (!pipe.done) {
+      if (veclisp_read(&read_scope, &x)) {
+        if (x.type == VECLISP_INT && x.as.integer == EOF) break;
+        *result = x;
+        return 1;
+      }
+      if (veclisp_pipe_push(scope, &pipe, x)) {
+        *result = pipe.acc;
+        return 1;
+      }
+    }
+    break;
+  default:
+    result->type = VECLISP_SYM;
+    result->as.sym = VECLISP_ERR_INVALID_SEQUENCE;
+    return 1;
+  }
+  if (!pipe.folding && pipe.tail == NULL) {
+    pipe.acc.as.vec[0].as.integer = pipe.used - 1;
+    pipe.acc.as.vec = GC_realloc(pipe.acc.as.vec, sizeof(*pipe.acc.as.vec) * pipe.used);
   }
-  int veclisp_n_readbytes(struct veclisp_scope *scope, struct veclisp_cell args, struct veclisp_cell *result) {
+  *result = pipe.acc;
+  return 0;
+}
+/* the loop forms below bind their variable in one frame on the C stack
+   and overwrite it in place, so an iteration allocates nothing itself. */
+int veclisp_n_while(struct veclisp_scope *scope, struct veclisp_cell args, struct veclisp_cell *result) {
+  struct veclisp_cell *a;
+  struct veclisp_scope while_scope;
+  struct veclisp_bindings while_bindings;
+  while_scope.bindings = &while_bindings;
+  while_scope.next = scope;
+  while_bindings.sym = VECLISP_AT;
+  while_bindings.next = NULL;
+  result->type = VECLISP_PAIR;
+  result->as.pair = NULL;
+  for (;;) {
+    if (veclisp_eval(scope, args.as.pair[0], &while_bindings.value)) {
+      *result = while_bindings.value;
+      return 1;
+    }
+    if (while_bindings.value.type == VECLISP_PAIR && while_bindings.value.as.pair == NULL) return 0;
+    FORPAIR(a, &args.as.pair[1]) {
+      if (veclisp_eval(&while_scope, a->as.pair[0], result)) return 1;
+    }
   }
-  int veclisp_n_readline(struct veclisp_scope *scope, struct veclisp_cell args, struct veclisp_cell *result) {
+}
+int veclisp_loop(struct veclisp_scope *scope, char *var, int64_t start, int64_t end, int64_t step, struct veclisp_cell body, struct veclisp_cell *result) {
+  struct veclisp_cell *a;
+  struct veclisp_scope loop_scope;
+  struct veclisp_bindings loop_bindings;
+  loop_scope.bindings = &loop_bindings;
+  loop_scope.next = scope;
+  loop_bindings.sym = var;
+  veclisp_rebind_local(var);
+  loop_bindings.next = NULL;
+  result->type = VECLISP_PAIR;
+  result->as.pair = NULL;
+  for (; step > 0 ? start < end : start > end; start += step) {
+    loop_bindings.value.type = VECLISP_INT;
+    loop_bindings.value.as.integer = start;
+    FORPAIR(a, &body) {
+      if (veclisp_eval(&loop_scope, a->as.pair[0], result)) return 1;
+    }
   }
-*/
+  return 0;
+}
+int veclisp_eval_int(struct veclisp_scope *scope, struct veclisp_cell expr, int64_t *value, struct veclisp_cell *result) {
+  if (veclisp_eval(scope, expr, result)) return 1;
+  if (result->type != VECLISP_INT) {
+    result->type = VECLISP_SYM;
+    result->as.sym = VECLISP_ERR_EXPECTED_INT;
+    return 1;
+  }
+  *value = result->as.integer;
+  return 0;
+}
+int veclisp_n_dotimes(struct veclisp_scope *scope, struct veclisp_cell args, struct veclisp_cell *result) {
+  int64_t n;
+  struct veclisp_cell spec = args.as.pair != NULL ? args.as.pair[0] : args;
+  if (spec.type != VECLISP_PAIR || spec.as.pair == NULL || spec.as.pair[0].type != VECLISP_SYM) {
+    result->type = VECLISP_SYM;
+    result->as.sym = VECLISP_ERR_INVALID_NAME;
+    return 1;
+  }
+  if (spec.as.pair[1].type != VECLISP_PAIR || spec.as.pair[1].as.pair == NULL) {
+    result->type = VECLISP_SYM;
+    result->as.sym = VECLISP_ERR_EXPECTED_INT;
+    return 1;
+  }
+  if (veclisp_eval_int(scope, spec.as.pair[1].as.pair[0], &n, result)) return 1;
+  return veclisp_loop(scope, spec.as.pair[0].as.sym, 0, n, 1, args.as.pair[1], result);
+}
+int veclisp_n_forrange(struct veclisp_scope *scope, struct veclisp_cell args, struct veclisp_cell *result) {
+  int64_t start, end, step = 1, n = 0;
+  struct veclisp_cell spec = args.as.pair != NULL ? args.as.pair[0] : args, *bounds, *a;
+  if (spec.type != VECLISP_PAIR || spec.as.pair == NULL || spec.as.pair[0].type != VECLISP_SYM) {
+    result->type = VECLISP_SYM;
+    result->as.sym = VECLISP_ERR_INVALID_NAME;
+    return 1;
+  }
+  FORPAIR(a, &spec.as.pair[1]) ++n;
+  if (n < 2) {
+    result->type = VECLISP_SYM;
+    result->as.sym = VECLISP_ERR_EXPECTED_INT;
+    return 1;
+  }
+  bounds = spec.as.pair[1].as.pair;
+  if (veclisp_eval_int(scope, bounds[0], &start, result)
+      || veclisp_eval_int(scope, bounds[1].as.pair[0], &end, result))
+    return 1;
+  if (n > 2 && veclisp_eval_int(scope, bounds[1].as.pair[1].as.pair[0], &step, result))
+    return 1;
+  if (step == 0) {
+    result->type = VECLISP_SYM;
+    result->as.sym = VECLISP_ERR_INVALID_STEP;
+    return 1;
+  }
+  return veclisp_loop(scope, spec.as.pair[0].as.sym, start, end, step, args.as.pair[1], result);
+}
+int veclisp_range_bounds(struct veclisp_cell seq, int64_t *start, int64_t *end, int64_t *step) {
+  if (seq.type != VECLISP_LAZY || seq.as.lazy->kind != VECLISP_LAZY_RANGE) return 0;
+  *start = seq.as.lazy->seed.as.integer;
+  *end = seq.as.lazy->pred.as.integer;
+  *step = seq.as.lazy->step.as.integer;
+  return 1;
+}
+int veclisp_n_range(struct veclisp_scope *scope, struct veclisp_cell args, struct veclisp_cell *result) {
+  int64_t n[3], count = 0;
+  struct veclisp_cell *a;
+  struct veclisp_lazy *l;
+  FORPAIR(a, &args) {
+    if (count == 3) break;
+    if (veclisp_eval_int(scope, a->as.pair[0], &n[count++], result)) return 1;
+  }
+  l = veclisp_alloc_lazy(VECLISP_LAZY_RANGE);
+  l->seed.type = l->pred.type = l->step.type = VECLISP_INT;
+  l->seed.as.integer = count > 1 ? n[0] : 0;
+  l->pred.as.integer = count > 1 ? n[1] : count ? n[0] : 0;
+  l->step.as.integer = count > 2 ? n[2] : 1;
+  if (l->step.as.integer == 0) {
+    result->type = VECLISP_SYM;
+    result->as.sym = VECLISP_ERR_INVALID_STEP;
+    return 1;
+  }
+  result->type = VECLISP_LAZY;
+  result->as.lazy = l;
+  return 0;
+}
+struct veclisp_bytes *veclisp_alloc_bytes(int64_t length, int64_t capacity) {
+  struct veclisp_bytes *b = GC_malloc(sizeof(*b));
+  b->length = length;
+  b->capacity = capacity < length ? length : capacity;
+  b->data = GC_malloc_atomic(b->capacity ? b->capacity : 1);
+  return b;
+}
+/* growing copies into a new buffer and leaves the old one alone, since
+   views of b, or b itself if it is a view, may still point into it */
+void veclisp_bytes_reserve(struct veclisp_bytes *b, int64_t capacity) {
+  unsigned char *data;
+  if (capacity <= b->capacity) return;
+  if (capacity < 2 * b->capacity) capacity = 2 * b->capacity;
+  data = GC_malloc_atomic(capacity);
+  memcpy(data, b->data, b->length);
+  b->data = data;
+  b->flags &= ~VECLISP_BYTES_VIEW;
+  b->owner = NULL;
+  b->capacity = capacity;
+}
+int veclisp_port_arg(struct veclisp_scope *scope, struct veclisp_cell args, FILE **port, struct veclisp_cell *result) {
+  struct veclisp_cell p;
+  if (args.type == VECLISP_PAIR && args.as.pair != NULL) {
+    if (veclisp_eval(scope, args.as.pair[0], &p)) {
+      *result = p;
+      return 1;
+    }
+  } else if (veclisp_scope_lookup(scope, VECLISP_INPORT, &p) || p.type != VECLISP_INT) {
+    p.type = VECLISP_INT;
+    p.as.integer = (int64_t)stdin;
+  }
+  if (p.type != VECLISP_INT) {
+    result->type = VECLISP_SYM;
+    result->as.sym = VECLISP_ERR_EXPECTED_INT;
+    return 1;
+  }
+  *port = (FILE *)p.as.integer;
+  return 0;
+}
+int veclisp_bytes_arg(struct veclisp_scope *scope, struct veclisp_cell expr, struct veclisp_bytes **bytes, struct veclisp_cell *result) {
+  if (veclisp_eval(scope, expr, result)) return 1;
+  if (result->type != VECLISP_BYTES) {
+    result->type = VECLISP_SYM;
+    result->as.sym = VECLISP_ERR_EXPECTED_BYTES;
+    return 1;
+  }
+  if (result->as.bytes->flags & VECLISP_BYTES_READONLY) {
+    result->type = VECLISP_SYM;
+    result->as.sym = VECLISP_ERR_READ_ONLY;
+    return 1;
+  }
+  *bytes = result->as.bytes;
+  return 0;
+}
+int veclisp_n_bytes(struct veclisp_scope *scope, struct veclisp_cell args, struct veclisp_cell *result) {
+  struct veclisp_cell value, *a;
+  int64_t used = 0, allocated = 32;
+  char *data = GC_malloc_atomic(sizeof(*data) * allocated);
+  FORPAIR(a, &args) {
+    if (veclisp_eval(scope, a->as.pair[0], &value)) {
+      *result = value;
+      return 1;
+    }
+    data = veclisp_pack(value, &used, &allocated, data);
+  }
+  result->type = VECLISP_BYTES;
+  result->as.bytes = GC_malloc(sizeof(*result->as.bytes));
+  result->as.bytes->length = used;
+  result->as.bytes->capacity = allocated;
+  result->as.bytes->data = (unsigned char *)data;
+  return 0;
+}
+int veclisp_n_makebytes(struct veclisp_scope *scope, struct veclisp_cell args, struct veclisp_cell *result) {
+  int64_t length, fill = 0;
+  if (veclisp_eval_int(scope, args.as.pair[0], &length, result)) return 1;
+  if (args.as.pair[1].as.pair != NULL && veclisp_eval_int(scope, args.as.pair[1].as.pair[0], &fill, result)) return 1;
+  if (length < 0) {
+    result->type = VECLISP_SYM;
+    result->as.sym = VECLISP_ERR_OUT_OF_RANGE;
+    return 1;
+  }
+  result->type = VECLISP_BYTES;
+  result->as.bytes = veclisp_alloc_bytes(length, length);
+  memset(result->as.bytes->data, (int)fill, length);
+  return 0;
+}
+/* read up to and not including the next newline into b, reusing its
+   storage. returns EOF only if nothing at all could be read. */
+int veclisp_readline(FILE *in, struct veclisp_bytes *b) {
+  int c;
+  b->length = 0;
+  flockfile(in);
+  while ((c = getc_unlocked(in)) != EOF && c != '\n') {
+    if (b->length >= b->capacity) veclisp_bytes_reserve(b, b->capacity + 64);
+    b->data[b->length++] = c;
+  }
+  funlockfile(in);
+  return c == EOF && b->length == 0 ? EOF : 0;
+}
+int veclisp_n_readline(struct veclisp_scope *scope, struct veclisp_cell args, struct veclisp_cell *result) {
+  FILE *in;
+  struct veclisp_bytes *b;
+  if (veclisp_port_arg(scope, args, &in, result)) return 1;
+  b = veclisp_alloc_bytes(0, 128);
+  result->type = VECLISP_PAIR;
+  result->as.pair = NULL;
+  if (veclisp_readline(in, b) == EOF) return 0;
+  b->data = GC_realloc(b->data, b->length ? b->length : 1);
+  b->capacity = b->length;
+  result->type = VECLISP_BYTES;
+  result->as.bytes = b;
+  return 0;
+}
+int veclisp_n_readlineinto(struct veclisp_scope *scope, struct veclisp_cell args, struct veclisp_cell *result) {
+  FILE *in;
+  struct veclisp_bytes *b;
+  if (veclisp_bytes_arg(scope, args.as.pair[0], &b, result)) return 1;
+  if (veclisp_port_arg(scope, args.as.pair[1], &in, result)) return 1;
+  if (veclisp_readline(in, b) == EOF) {
+    result->type = VECLISP_PAIR;
+    result->as.pair = NULL;
+  }
+  return 0;
+}
+int veclisp_n_readbytes(struct veclisp_scope *scope, struct veclisp_cell args, struct veclisp_cell *result) {
+  int64_t n;
+  FILE *in;
+  struct veclisp_bytes *b;
+  if (veclisp_eval_int(scope, args.as.pair[0], &n, result)) return 1;
+  if (veclisp_port_arg(scope, args.as.pair[1], &in, result)) return 1;
+  if (n < 0) {
+    result->type = VECLISP_SYM;
+    result->as.sym = VECLISP_ERR_OUT_OF_RANGE;
+    return 1;
+  }
+  b = veclisp_alloc_bytes(0, n);
+  b->length = fread(b->data, 1, n, in);
+  result->type = VECLISP_PAIR;
+  result->as.pair = NULL;
+  if (b->length == 0 && n != 0) return 0;
+  result->type = VECLISP_BYTES;
+  result->as.bytes = b;
+  return 0;
+}
+int veclisp_n_readbytesinto(struct veclisp_scope *scope, struct veclisp_cell args, struct veclisp_cell *result) {
+  FILE *in;
+  struct veclisp_bytes *b;
+  if (veclisp_bytes_arg(scope, args.as.pair[0], &b, result)) return 1;
+  if (veclisp_port_arg(scope, args.as.pair[1], &in, result)) return 1;
+  b->length = fread(b->data, 1, b->capacity, in);
+  if (b->length == 0 && b->capacity != 0) {
+    result->type = VECLISP_PAIR;
+    result->as.pair = NULL;
+  }
+  return 0;
+}
+void veclisp_unmap_bytes(void *obj, void *client_data) {
+  struct veclisp_bytes *b = obj;
+  munmap(b->data, b->capacity);
+}
+int veclisp_n_mapfile(struct veclisp_scope *scope, struct veclisp_cell args, struct veclisp_cell *result) {
+  int fd;
+  struct stat st;
+  struct veclisp_cell filename;
+  struct veclisp_bytes *b;
+  void *data;
+  if (veclisp_eval(scope, args.as.pair[0], &filename)) {
+    *result = filename;
+    return 1;
+  }
+  if (filename.type != VECLISP_SYM) {
+    result->type = VECLISP_SYM;
+    result->as.sym = VECLISP_ERR_INVALID_NAME;
+    return 1;
+  }
+  if ((fd = open(filename.as.sym, O_RDONLY)) < 0) goto fail;
+  if (fstat(fd, &st)) {
+    close(fd);
+    goto fail;
+  }
+  if (st.st_size == 0) {
+    close(fd);
+    b = veclisp_alloc_bytes(0, 0);
+    b->flags = VECLISP_BYTES_READONLY;
+  } else {
+    data = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (data == MAP_FAILED) goto fail;
+    b = GC_malloc(sizeof(*b));
+    b->data = data;
+    b->length = b->capacity = st.st_size;
+    b->flags = VECLISP_BYTES_READONLY | VECLISP_BYTES_MAPPED;
+    GC_register_finalizer(b, veclisp_unmap_bytes, NULL, NULL, NULL);
+  }
+  result->type = VECLISP_BYTES;
+  result->as.bytes = b;
+  return 0;
+ fail:
+  result->type = VECLISP_SYM;
+  result->as.sym = veclisp_intern(strerror(errno));
+  return 1;
+}
+/* finds up to n - 1 places to cut data between top-level forms,
+   following the reader's strings, escapes and nesting. each cut is on
+   whitespace at or after the next n-th of the data; cuts[0] is 0 and
+   cuts[pieces] is the length. returns the number of pieces. */
+int64_t veclisp_split_forms(const unsigned char *data, int64_t len, int64_t n, int64_t *cuts) {
+  int64_t i = 0, depth = 0, pieces = 1;
+  int prefixed = 0, c;
+  cuts[0] = 0;
+  while (i < len && pieces < n) {
+    c = data[i];
+    if (isspace(c)) {
+      if (depth == 0 && !prefixed && i >= len / n * pieces) cuts[pieces++] = i;
+      ++i;
+      continue;
+    }
+    if (c == '\'' || c == '`' || c == ',') {
+      prefixed = 1;
+      ++i;
+      continue;
+    }
+    prefixed = 0;
+    if (c == '(' || c == '[') {
+      depth++;
+      ++i;
+    } else if (c == ')' || c == ']') {
+      depth--;
+      ++i;
+    } else if (c == '"' || (c == '#' && i + 1 < len && data[i + 1] == '"')) {
+      for (i += c == '#' ? 2 : 1; i < len && data[i] != '"'; ++i)
+        if (data[i] == '\\') ++i;
+      ++i;
+    } else if (isdigit(c) || (c == '-' && i + 1 < len && isdigit(data[i + 1]))) {
+      for (++i; i < len && isdigit(data[i]); ++i);
+    } else {
+      for (++i; i < len && !isspace(data[i]) && data[i] != '(' && data[i] != ')' && data[i] != '[' && data[i] != ']'; ++i);
+    }
+  }
+  cuts[pieces] = len;
+  return pieces;
+}
+void *veclisp_read_chunk_main(void *arg) {
+  struct veclisp_read_chunk *chunk = arg;
+  struct veclisp_scope chunk_scope;
+  struct veclisp_bindings chunk_bindings;
+  struct veclisp_cell form;
+  int64_t allocated = 64;
+  FILE *in;
+  if ((in = fmemopen((void *)chunk->data, chunk->length, "r")) == NULL) {
+    chunk->failed = 1;
+    chunk->err.type = VECLISP_SYM;
+    chunk->err.as.sym = veclisp_intern(strerror(errno));
+    return NULL;
+  }
+  chunk_scope.next = NULL;
+  chunk_scope.bindings = &chunk_bindings;
+  chunk_bindings.next = NULL;
+  chunk_bindings.sym = VECLISP_INPORT;
+  chunk_bindings.value.type = VECLISP_INT;
+  chunk_bindings.value.as.integer = (int64_t)in;
+  chunk->forms = GC_malloc(sizeof(*chunk->forms) * allocated);
+  while (!veclisp_read(&chunk_scope, &form)) {
+    if (chunk->count >= allocated) {
+      allocated *= 2;
+      chunk->forms = GC_realloc(chunk->forms, sizeof(*chunk->forms) * allocated);
+    }
+    chunk->forms[chunk->count++] = form;
+  }
+  if (form.type != VECLISP_INT || form.as.integer != EOF) {
+    chunk->failed = 1;
+    chunk->err = form;
+  }
+  fclose(in);
+  return NULL;
+}
+/* (read-all-parallel FILENAME [THREADS]) maps the file, cuts it between
+   top-level forms and reads the pieces on up to THREADS threads,
+   defaulting to one per processor. returns a vector of the forms in
+   file order, or the first piece's read error. */
+int veclisp_n_readallparallel(struct veclisp_scope *scope, struct veclisp_cell args, struct veclisp_cell *result) {
+  struct veclisp_cell file, *elems;
+  struct veclisp_read_chunk *chunks;
+  struct veclisp_bytes *b;
+  int64_t threads, pieces, *cuts, total = 0, i;
+  if (veclisp_n_mapfile(scope, args, &file)) {
+    *result = file;
+    return 1;
+  }
+  b = file.as.bytes;
+  threads = sysconf(_SC_NPROCESSORS_ONLN);
+  if (args.as.pair[1].as.pair != NULL
+      && veclisp_eval_int(scope, args.as.pair[1].as.pair[0], &threads, result))
+    return 1;
+  if (threads < 1) {
+    result->type = VECLISP_SYM;
+    result->as.sym = VECLISP_ERR_OUT_OF_RANGE;
+    return 1;
+  }
+  if (threads > b->length / VECLISP_READ_PIECE_MIN + 1) threads = b->length / VECLISP_READ_PIECE_MIN + 1;
+  cuts = malloc(sizeof(*cuts) * (threads + 1));
+  pieces = veclisp_split_forms(b->data, b->length, threads, cuts);
+  chunks = GC_malloc(sizeof(*chunks) * pieces);
+  for (i = 0; i < pieces; ++i) {
+    chunks[i].bytes = b;
+    chunks[i].data = b->data + cuts[i];
+    chunks[i].length = cuts[i + 1] - cuts[i];
+  }
+  free(cuts);
+  for (i = 1; i < pieces; ++i)
+    chunks[i].started = !pthread_create(&chunks[i].thread, NULL, veclisp_read_chunk_main, &chunks[i]);
+  /* the calling thread reads the first piece and any that failed to start */
+  for (i = 0; i < pieces; ++i) {
+    if (chunks[i].started) pthread_join(chunks[i].thread, NULL);
+    else if (chunks[i].length > 0) veclisp_read_chunk_main(&chunks[i]);
+  }
+  for (i = 0; i < pieces; ++i) {
+    if (chunks[i].failed) {
+      *result = chunks[i].err;
+      return 1;
+    }
+    total += chunks[i].count;
+  }
+  result->type = VECLISP_VEC;
+  result->as.vec = veclisp_alloc_vec(total);
+  elems = VECLISP_VELEMS(result->as.vec) + 1;
+  for (i = 0; i < pieces; elems += chunks[i++].count)
+    if (chunks[i].count > 0) memcpy(elems, chunks[i].forms, sizeof(*elems) * chunks[i].count);
+  return 0;
+}
+/* the vectors a bulk operation works on, and the element range it was
+   given: START and END default to the whole vector */
+int veclisp_vec_arg(struct veclisp_scope *scope, struct veclisp_cell expr, struct veclisp_cell **elems, int64_t *len, struct veclisp_cell *result) {
+  if (veclisp_eval(scope, expr, result)) return 1;
+  if (result->type != VECLISP_VEC) {
+    result->type = VECLISP_SYM;
+    result->as.sym = VECLISP_ERR_EXPECTED_VEC;
+    return 1;
+  }
+  *elems = VECLISP_VELEMS(result->as.vec) + 1;
+  *len = VECLISP_VLEN(result->as.vec);
+  return 0;
+}
+int veclisp_range_args(struct veclisp_scope *scope, struct veclisp_cell args, int64_t len, int64_t *start, int64_t *end, struct veclisp_cell *result) {
+  *start = 0;
+  *end = len;
+  if (args.type == VECLISP_PAIR && args.as.pair != NULL) {
+    if (veclisp_eval_int(scope, args.as.pair[0], start, result)) return 1;
+    args = args.as.pair[1];
+    if (args.type == VECLISP_PAIR && args.as.pair != NULL
+        && veclisp_eval_int(scope, args.as.pair[0], end, result))
+      return 1;
+  }
+  if (*start < 0 || *end < *start || *end > len) {
+    result->type = VECLISP_SYM;
+    result->as.sym = VECLISP_ERR_OUT_OF_RANGE;
+    return 1;
+  }
+  return 0;
+}
+/* (slice V START [END]) shares V's elements; (subvec V START [END])
+   copies them. a slice of a slice points straight at the storage. */
+int veclisp_vec_slice(struct veclisp_scope *scope, struct veclisp_cell vec, struct veclisp_cell range, int copy, struct veclisp_cell *result) {
+  int64_t start, end;
+  struct veclisp_cell *elems = copy ? VECLISP_VELEMS(vec.as.vec) : veclisp_vec_writable(vec.as.vec);
+  if (veclisp_range_args(scope, range, VECLISP_VLEN(vec.as.vec), &start, &end, result)) return 1;
+  result->type = VECLISP_VEC;
+  if (copy) {
+    result->as.vec = veclisp_alloc_vec(end - start);
+    memcpy(result->as.vec + 1, elems + 1 + start, sizeof(*elems) * (end - start));
+    return 0;
+  }
+  result->as.vec = GC_malloc(sizeof(*result->as.vec) * 3);
+  result->as.vec[0].type = VECLISP_VEC;
+  result->as.vec[0].as.vec = elems + start;
+  result->as.vec[1].type = VECLISP_INT;
+  result->as.vec[1].as.integer = end - start;
+  result->as.vec[2].type = VECLISP_PAIR;
+  result->as.vec[2].as.pair = NULL;
+  return 0;
+}
+int veclisp_n_subvec(struct veclisp_scope *scope, struct veclisp_cell args, struct veclisp_cell *result) {
+  struct veclisp_cell *elems;
+  int64_t len;
+  if (veclisp_vec_arg(scope, args.as.pair[0], &elems, &len, result)) return 1;
+  return veclisp_vec_slice(scope, *result, args.as.pair[1], 1, result);
+}
+/* (vector-copy! DST AT SRC [START [END]]) copies SRC's range into DST
+   at AT. the ranges may overlap when both share storage. */
+int veclisp_n_vectorcopy(struct veclisp_scope *scope, struct veclisp_cell args, struct veclisp_cell *result) {
+  struct veclisp_cell dst, *to, *from;
+  int64_t to_len, from_len, at, start, end;
+  if (veclisp_vec_arg(scope, args.as.pair[0], &to, &to_len, result)) return 1;
+  dst = *result;
+  args = args.as.pair[1];
+  if (veclisp_eval_int(scope, args.as.pair[0], &at, result)) return 1;
+  args = args.as.pair[1];
+  if (veclisp_vec_arg(scope, args.as.pair[0], &from, &from_len, result)) return 1;
+  if (veclisp_range_args(scope, args.as.pair[1], from_len, &start, &end, result)) return 1;
+  if (at < 0 || at + end - start > to_len) {
+    result->type = VECLISP_SYM;
+    result->as.sym = VECLISP_ERR_OUT_OF_RANGE;
+    return 1;
+  }
+  if (veclisp_frozen_p(to)) {
+    result->type = VECLISP_SYM;
+    result->as.sym = VECLISP_ERR_READ_ONLY;
+    return 1;
+  }
+  to = veclisp_vec_writable(dst.as.vec) + 1;
+  memmove(to + at, from + start, sizeof(*to) * (end - start));
+  *result = dst;
+  return 0;
+}
+/* (vector-fill! V X [START [END]]) */
+int veclisp_n_vectorfill(struct veclisp_scope *scope, struct veclisp_cell args, struct veclisp_cell *result) {
+  struct veclisp_cell vec, x, *elems;
+  int64_t len, start, end, i;
+  if (veclisp_vec_arg(scope, args.as.pair[0], &elems, &len, result)) return 1;
+  vec = *result;
+  if (veclisp_eval(scope, args.as.pair[1].as.pair[0], &x)) {
+    *result = x;
+    return 1;
+  }
+  if (veclisp_range_args(scope, args.as.pair[1].as.pair[1], len, &start, &end, result)) return 1;
+  if (veclisp_frozen_p(elems)) {
+    result->type = VECLISP_SYM;
+    result->as.sym = VECLISP_ERR_READ_ONLY;
+    return 1;
+  }
+  elems = veclisp_vec_writable(vec.as.vec) + 1;
+  /* doubling copies fill the range in log n memcpy calls */
+  if (end > start) elems[start] = x;
+  for (i = 1; i < end - start; i *= 2)
+    memcpy(elems + start + i, elems + start, sizeof(*elems) * (i < end - start - i ? i : end - start - i));
+  *result = vec;
+  return 0;
+}
+/* (vector-concat V...) */
+int veclisp_n_vectorconcat(struct veclisp_scope *scope, struct veclisp_cell args, struct veclisp_cell *result) {
+  struct veclisp_cell *a, *elems, *vecs;
+  int64_t count = 0, total = 0, len, i, at;
+  FORPAIR(a, &args) count++;
+  vecs = GC_malloc(sizeof(*vecs) * (count ? count : 1));
+  i = 0;
+  FORPAIR(a, &args) {
+    if (veclisp_vec_arg(scope, a->as.pair[0], &elems, &len, result)) return 1;
+    vecs[i++] = *result;
+    total += len;
+  }
+  result->type = VECLISP_VEC;
+  result->as.vec = veclisp_alloc_vec(total);
+  for (i = 0, at = 1; i < count; ++i) {
+    len = VECLISP_VLEN(vecs[i].as.vec);
+    memcpy(result->as.vec + at, VECLISP_VELEMS(vecs[i].as.vec) + 1, sizeof(*result->as.vec) * len);
+    at += len;
+  }
+  return 0;
+}
+/* growable vectors double their storage when full, so pushing is
+   amortized constant time. growing copies into new storage and leaves
+   the old block alone, so slices taken before keep seeing it. */
+int veclisp_growable_arg(struct veclisp_scope *scope, struct veclisp_cell expr, struct veclisp_cell *result) {
+  if (veclisp_eval(scope, expr, result)) return 1;
+  if (result->type != VECLISP_VEC || result->as.vec[0].type != VECLISP_VEC || result->as.vec[2].type != VECLISP_INT) {
+    result->type = VECLISP_SYM;
+    result->as.sym = VECLISP_ERR_EXPECTED_GROWABLE;
+    return 1;
+  }
+  return 0;
+}
+/* room for capacity elements, or NULL with the error in result */
+struct veclisp_cell *veclisp_vec_storage(int64_t capacity, struct veclisp_cell *result) {
+  struct veclisp_cell *elems;
+  if (capacity < 0 || (uint64_t)capacity > SIZE_MAX / sizeof(*elems) - 1) {
+    result->type = VECLISP_SYM;
+    result->as.sym = VECLISP_ERR_OUT_OF_RANGE;
+    return NULL;
+  }
+  if ((elems = GC_malloc(sizeof(*elems) * (capacity + 1))) == NULL) {
+    result->type = VECLISP_SYM;
+    result->as.sym = veclisp_intern(strerror(ENOMEM));
+  }
+  return elems;
+}
+int veclisp_vec_reserve(struct veclisp_cell *header, int64_t capacity, struct veclisp_cell *result) {
+  struct veclisp_cell *elems;
+  if (capacity >= 0 && capacity <= header[2].as.integer) return 0;
+  if ((elems = veclisp_vec_storage(capacity, result)) == NULL) return 1;
+  memcpy(elems + 1, header[0].as.vec + 1, sizeof(*elems) * header[1].as.integer);
+  header[0].as.vec = elems;
+  header[2].as.integer = capacity;
+  return 0;
+}
+/* (make-vector [CAPACITY]) is an empty growable vector */
+int veclisp_n_makevector(struct veclisp_scope *scope, struct veclisp_cell args, struct veclisp_cell *result) {
+  int64_t capacity = 8;
+  struct veclisp_cell *elems;
+  if (args.type == VECLISP_PAIR && args.as.pair != NULL
+      && veclisp_eval_int(scope, args.as.pair[0], &capacity, result))
+    return 1;
+  if (capacity == 0) capacity = 1;
+  if ((elems = veclisp_vec_storage(capacity, result)) == NULL) return 1;
+  result->type = VECLISP_VEC;
+  result->as.vec = GC_malloc(sizeof(*result->as.vec) * 3);
+  result->as.vec[0].type = VECLISP_VEC;
+  result->as.vec[0].as.vec = elems;
+  result->as.vec[1].type = result->as.vec[2].type = VECLISP_INT;
+  result->as.vec[1].as.integer = 0;
+  result->as.vec[2].as.integer = capacity;
+  return 0;
+}
+/* (vector-push! V X) appends X and returns it */
+int veclisp_n_vectorpush(struct veclisp_scope *scope, struct veclisp_cell args, struct veclisp_cell *result) {
+  struct veclisp_cell vec, x, *header;
+  if (veclisp_growable_arg(scope, args.as.pair[0], &vec)) {
+    *result = vec;
+    return 1;
+  }
+  if (veclisp_eval(scope, args.as.pair[1].as.pair[0], &x)) {
+    *result = x;
+    return 1;
+  }
+  header = vec.as.vec;
+  if (header[1].as.integer == header[2].as.integer && veclisp_vec_reserve(header, header[2].as.integer * 2, result)) return 1;
+  *result = x;
+  header[0].as.vec[++header[1].as.integer] = *result;
+  return 0;
+}
+/* (vector-pop! V) removes and returns the last element */
+int veclisp_n_vectorpop(struct veclisp_scope *scope, struct veclisp_cell args, struct veclisp_cell *result) {
+  struct veclisp_cell *header;
+  if (veclisp_growable_arg(scope, args.as.pair[0], result)) return 1;
+  header = result->as.vec;
+  if (header[1].as.integer == 0) {
+    result->type = VECLISP_SYM;
+    result->as.sym = VECLISP_ERR_OUT_OF_RANGE;
+    return 1;
+  }
+  *result = header[0].as.vec[header[1].as.integer];
+  header[0].as.vec[header[1].as.integer--].type = VECLISP_INT;
+  return 0;
+}
+/* (vector-reserve! V N) makes room for N elements without growing again */
+int veclisp_n_vectorreserve(struct veclisp_scope *scope, struct veclisp_cell args, struct veclisp_cell *result) {
+  int64_t capacity;
+  struct veclisp_cell vec;
+  if (veclisp_growable_arg(scope, args.as.pair[0], &vec)) {
+    *result = vec;
+    return 1;
+  }
+  if (veclisp_eval_int(scope, args.as.pair[1].as.pair[0], &capacity, result)) return 1;
+  if (veclisp_vec_reserve(vec.as.vec, capacity, result)) return 1;
+  *result = vec;
+  return 0;
+}
+/* (vector-capacity V) is the number of elements a growable vector's
+   storage holds in all, not the room left in it; for fixed vectors and
+   slices it is their length */
+int veclisp_n_vectorcapacity(struct veclisp_scope *scope, struct veclisp_cell args, struct veclisp_cell *result) {
+  struct veclisp_cell *elems;
+  int64_t len;
+  if (veclisp_vec_arg(scope, args.as.pair[0], &elems, &len, result)) return 1;
+  if (result->as.vec[0].type == VECLISP_VEC && result->as.vec[2].type == VECLISP_INT) len = result->as.vec[2].as.integer;
+  result->type = VECLISP_INT;
+  result->as.integer = len;
+  return 0;
+}
+int veclisp_n_slice(struct veclisp_scope *scope, struct veclisp_cell args, struct veclisp_cell *result) {
+  int64_t start, end;
+  struct veclisp_bytes *b, *view;
+  if (veclisp_eval(scope, args.as.pair[0], result)) return 1;
+  if (result->type == VECLISP_VEC) return veclisp_vec_slice(scope, *result, args.as.pair[1], 0, result);
+  if (result->type != VECLISP_BYTES) {
+    result->type = VECLISP_SYM;
+    result->as.sym = VECLISP_ERR_EXPECTED_BYTES;
+    return 1;
+  }
+  b = result->as.bytes;
+  if (veclisp_eval_int(scope, args.as.pair[1].as.pair[0], &start, result)) return 1;
+  end = b->length;
+  if (args.as.pair[1].as.pair[1].as.pair != NULL
+      && veclisp_eval_int(scope, args.as.pair[1].as.pair[1].as.pair[0], &end, result))
+    return 1;
+  if (start < 0 || end < start || end > b->length) {
+    result->type = VECLISP_SYM;
+    result->as.sym = VECLISP_ERR_OUT_OF_RANGE;
+    return 1;
+  }
+  view = GC_malloc(sizeof(*view));
+  view->data = b->data + start;
+  view->length = view->capacity = end - start;
+  view->flags = (b->flags & VECLISP_BYTES_READONLY) | VECLISP_BYTES_VIEW;
+  view->owner = b->owner ? b->owner : b;
+  result->type = VECLISP_BYTES;
+  result->as.bytes = view;
+  return 0;
+}
+/* non-blocking descriptors are driven by one epoll instance. callbacks
+   registered with on-readable and on-writable run from event-loop, and
+   ports made by fd-port wait for readiness by running the loop, so other
+   descriptors keep being served while one port is blocked. */
+struct veclisp_watch *veclisp_watch(int fd) {
+  int64_t allocated = veclisp_current->event_loop.allocated;
+  if (veclisp_current->event_loop.watches == NULL) veclisp_current->event_loop.epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+  if (fd >= allocated) {
+    while (fd >= allocated) allocated = allocated ? allocated * 2 : 64;
+    veclisp_current->event_loop.watches = GC_realloc(veclisp_current->event_loop.watches, sizeof(*veclisp_current->event_loop.watches) * allocated);
+    memset(veclisp_current->event_loop.watches + veclisp_current->event_loop.allocated, 0,
+           sizeof(*veclisp_current->event_loop.watches) * (allocated - veclisp_current->event_loop.allocated));
+    for (; veclisp_current->event_loop.allocated < allocated; ++veclisp_current->event_loop.allocated) {
+      veclisp_current->event_loop.watches[veclisp_current->event_loop.allocated].on_read.type = VECLISP_PAIR;
+      veclisp_current->event_loop.watches[veclisp_current->event_loop.allocated].on_write.type = VECLISP_PAIR;
+    }
+  }
+  return &veclisp_current->event_loop.watches[fd];
+}
+int veclisp_watching(struct veclisp_cell callback) {
+  return !(callback.type == VECLISP_PAIR && callback.as.pair == NULL);
+}
+void veclisp_watch_update(int fd) {
+  struct veclisp_watch *w = veclisp_watch(fd);
+  struct epoll_event ev;
+  ev.events = 0;
+  ev.data.fd = fd;
+  if (veclisp_watching(w->on_read) || (w->waiting & EPOLLIN)) ev.events |= EPOLLIN;
+  if (veclisp_watching(w->on_write) || (w->waiting & EPOLLOUT)) ev.events |= EPOLLOUT;
+  if (ev.events == w->registered) return;
+  if (ev.events == 0) epoll_ctl(veclisp_current->event_loop.epoll_fd, EPOLL_CTL_DEL, fd, &ev);
+  else if (w->registered == 0) epoll_ctl(veclisp_current->event_loop.epoll_fd, EPOLL_CTL_ADD, fd, &ev);
+  else epoll_ctl(veclisp_current->event_loop.epoll_fd, EPOLL_CTL_MOD, fd, &ev);
+  w->registered = ev.events;
+}
+void veclisp_watch_set(int fd, struct veclisp_cell *slot, struct veclisp_cell callback) {
+  int before = veclisp_watching(*slot);
+  *slot = callback;
+  veclisp_current->event_loop.watch_count += veclisp_watching(callback) - before;
+  veclisp_watch_update(fd);
+}
+void veclisp_unwatch(int fd) {
+  struct veclisp_watch *w;
+  struct veclisp_cell nil;
+  if (fd >= veclisp_current->event_loop.allocated) return;
+  w = veclisp_watch(fd);
+  nil.type = VECLISP_PAIR;
+  nil.as.pair = NULL;
+  veclisp_wake(&w->reader);
+  veclisp_wake(&w->writer);
+  w->waiting = w->ready = 0;
+  veclisp_watch_set(fd, &w->on_read, nil);
+  veclisp_watch_set(fd, &w->on_write, nil);
+}
+int veclisp_event_loop_once(struct veclisp_scope *scope, int timeout, int64_t *count, struct veclisp_cell *result) {
+  int i, n, fd;
+  struct epoll_event events[64];
+  struct veclisp_cell callback, arg;
+  struct veclisp_scope *outer = veclisp_current->event_loop.scope;
+  veclisp_watch(0);
+  n = epoll_wait(veclisp_current->event_loop.epoll_fd, events, 64, timeout);
+  if (n < 0) {
+    if (errno == EINTR) return 0;
+    result->type = VECLISP_SYM;
+    result->as.sym = veclisp_intern(strerror(errno));
+    return 1;
+  }
+  veclisp_current->event_loop.scope = scope;
+  arg.type = VECLISP_INT;
+  for (i = 0; i < n; ++i) {
+    fd = events[i].data.fd;
+    arg.as.integer = fd;
+    if (events[i].events & (EPOLLIN | EPOLLHUP | EPOLLERR)) {
+      if (veclisp_watch(fd)->waiting & EPOLLIN) {
+        veclisp_watch(fd)->ready |= EPOLLIN;
+        veclisp_wake(&veclisp_watch(fd)->reader);
+      } else if (veclisp_watching(callback = veclisp_watch(fd)->on_read)) {
+        (*count)++;
+        if (veclisp_apply1(scope, callback, arg, result)) goto fail;
+      }
+    }
+    if (events[i].events & (EPOLLOUT | EPOLLHUP | EPOLLERR)) {
+      if (veclisp_watch(fd)->waiting & EPOLLOUT) {
+        veclisp_watch(fd)->ready |= EPOLLOUT;
+        veclisp_wake(&veclisp_watch(fd)->writer);
+      } else if (veclisp_watching(callback = veclisp_watch(fd)->on_write)) {
+        (*count)++;
+        if (veclisp_apply1(scope, callback, arg, result)) goto fail;
+      }
+    }
+  }
+  veclisp_current->event_loop.scope = outer;
+  return 0;
+ fail:
+  veclisp_current->event_loop.scope = outer;
+  return 1;
+}
+/* a coroutine parks until its descriptor is ready. outside of coroutines
+   and event-loop there is nothing else to serve, so just block */
+int veclisp_wait_fd(int fd, uint32_t events) {
+  int64_t count = 0;
+  struct pollfd pfd;
+  struct veclisp_cell err;
+  struct veclisp_coroutine *co = veclisp_current->scheduler.current;
+  if (co == NULL && veclisp_current->event_loop.scope == NULL) {
+    pfd.fd = fd;
+    pfd.events = events & EPOLLIN ? POLLIN : POLLOUT;
+    return poll(&pfd, 1, -1) < 0 && errno != EINTR;
+  }
+  veclisp_watch(fd)->waiting |= events;
+  veclisp_watch(fd)->ready &= ~events;
+  veclisp_watch_update(fd);
+  if (co != NULL) {
+    if (events & EPOLLIN) {
+      co->next = veclisp_watch(fd)->reader;
+      veclisp_watch(fd)->reader = co;
+    } else {
+      co->next = veclisp_watch(fd)->writer;
+      veclisp_watch(fd)->writer = co;
+    }
+    veclisp_current->scheduler.io_waiting++;
+    veclisp_suspend(co);
+    veclisp_current->scheduler.io_waiting--;
+  } else {
+    while (!(veclisp_watch(fd)->ready & events)) {
+      if (veclisp_step(veclisp_current->event_loop.scope, -1, &count, &err))
+        veclisp_print_err(veclisp_current->event_loop.scope, err);
+    }
+  }
+  if ((events & EPOLLIN ? veclisp_watch(fd)->reader : veclisp_watch(fd)->writer) == NULL)
+    veclisp_watch(fd)->waiting &= ~events;
+  veclisp_watch_update(fd);
+  return 0;
+}
+/* a descriptor is checked against the process limit, which also bounds
+   the watch table it may index */
+int veclisp_fd_arg(struct veclisp_scope *scope, struct veclisp_cell expr, int *fd, struct veclisp_cell *result) {
+  int64_t n;
+  if (veclisp_eval_int(scope, expr, &n, result)) return 1;
+  if (n < 0 || n >= sysconf(_SC_OPEN_MAX)) {
+    result->type = VECLISP_SYM;
+    result->as.sym = VECLISP_ERR_OUT_OF_RANGE;
+    return 1;
+  }
+  *fd = (int)n;
+  return 0;
+}
+/* a descriptor that would block yields the symbol `again' rather than an error */
+int veclisp_errno_result(struct veclisp_cell *result) {
+  result->type = VECLISP_SYM;
+  if (errno == EAGAIN || errno == EWOULDBLOCK) {
+    result->as.sym = VECLISP_AGAIN;
+    return 0;
+  }
+  result->as.sym = veclisp_intern(strerror(errno));
+  return 1;
+}
+int veclisp_errno_err(struct veclisp_cell *result) {
+  result->type = VECLISP_SYM;
+  result->as.sym = veclisp_intern(strerror(errno));
+  return 1;
+}
+int veclisp_n_socketpair(struct veclisp_scope *scope, struct veclisp_cell args, struct veclisp_cell *result) {
+  int fds[2];
+  if (socketpair(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0, fds)) return veclisp_errno_err(result);
+  result->type = VECLISP_PAIR;
+  result->as.pair = veclisp_alloc_pair();
+  result->as.pair[0].type = result->as.pair[1].type = VECLISP_INT;
+  result->as.pair[0].as.integer = fds[0];
+  result->as.pair[1].as.integer = fds[1];
+  return 0;
+}
+int veclisp_unix_address(struct veclisp_scope *scope, struct veclisp_cell args, struct sockaddr_un *addr, struct veclisp_cell *result) {
+  if (veclisp_eval(scope, args.as.pair[0], result)) return 1;
+  if (result->type != VECLISP_SYM || strlen(result->as.sym) >= sizeof(addr->sun_path)) {
+    result->type = VECLISP_SYM;
+    result->as.sym = VECLISP_ERR_INVALID_NAME;
+    return 1;
+  }
+  memset(addr, 0, sizeof(*addr));
+  addr->sun_family = AF_UNIX;
+  strcpy(addr->sun_path, result->as.sym);
+  return 0;
+}
+int veclisp_n_unixlisten(struct veclisp_scope *scope, struct veclisp_cell args, struct veclisp_cell *result) {
+  int fd;
+  struct sockaddr_un addr;
+  if (veclisp_unix_address(scope, args, &addr, result)) return 1;
+  unlink(addr.sun_path);
+  if ((fd = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0)) < 0) return veclisp_errno_err(result);
+  if (bind(fd, (struct sockaddr *)&addr, sizeof(addr)) || listen(fd, SOMAXCONN)) {
+    veclisp_errno_err(result);
+    close(fd);
+    return 1;
+  }
+  result->type = VECLISP_INT;
+  result->as.integer = fd;
+  return 0;
+}
+int veclisp_n_unixconnect(struct veclisp_scope *scope, struct veclisp_cell args, struct veclisp_cell *result) {
+  int fd;
+  struct sockaddr_un addr;
+  if (veclisp_unix_address(scope, args, &addr, result)) return 1;
+  if ((fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0)) < 0) return veclisp_errno_err(result);
+  if (connect(fd, (struct sockaddr *)&addr, sizeof(addr))) {
+    veclisp_errno_err(result);
+    close(fd);
+    return 1;
+  }
+  fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+  result->type = VECLISP_INT;
+  result->as.integer = fd;
+  return 0;
+}
+int veclisp_n_accept(struct veclisp_scope *scope, struct veclisp_cell args, struct veclisp_cell *result) {
+  int fd, conn;
+  if (veclisp_fd_arg(scope, args.as.pair[0], &fd, result)) return 1;
+  if ((conn = accept4(fd, NULL, NULL, SOCK_NONBLOCK | SOCK_CLOEXEC)) < 0) return veclisp_errno_result(result);
+  result->type = VECLISP_INT;
+  result->as.integer = conn;
+  return 0;
+}
+int veclisp_n_fdread(struct veclisp_scope *scope, struct veclisp_cell args, struct veclisp_cell *result) {
+  int fd;
+  int64_t n;
+  ssize_t got;
+  struct veclisp_bytes *b;
+  if (veclisp_fd_arg(scope, args.as.pair[0], &fd, result)) return 1;
+  if (veclisp_eval_int(scope, args.as.pair[1].as.pair[0], &n, result)) return 1;
+  if (n < 0) {
+    result->type = VECLISP_SYM;
+    result->as.sym = VECLISP_ERR_OUT_OF_RANGE;
+    return 1;
+  }
+  b = veclisp_alloc_bytes(0, n);
+  if ((got = read(fd, b->data, n)) < 0) return veclisp_errno_result(result);
+  if (got == 0 && n != 0) {
+    result->type = VECLISP_PAIR;
+    result->as.pair = NULL;
+    return 0;
+  }
+  b->length = got;
+  result->type = VECLISP_BYTES;
+  result->as.bytes = b;
+  return 0;
+}
+int veclisp_n_fdwrite(struct veclisp_scope *scope, struct veclisp_cell args, struct veclisp_cell *result) {
+  int fd;
+  ssize_t n;
+  struct veclisp_cell data;
+  if (veclisp_fd_arg(scope, args.as.pair[0], &fd, result)) return 1;
+  if (veclisp_eval(scope, args.as.pair[1].as.pair[0], &data)) {
+    *result = data;
+    return 1;
+  }
+  if (data.type == VECLISP_BYTES) {
+    n = write(fd, data.as.bytes->data, data.as.bytes->length);
+  } else if (data.type == VECLISP_SYM) {
+    n = write(fd, data.as.sym, strlen(data.as.sym));
+  } else {
+    result->type = VECLISP_SYM;
+    result->as.sym = VECLISP_ERR_EXPECTED_BYTES;
+    return 1;
+  }
+  if (n < 0) return veclisp_errno_result(result);
+  result->type = VECLISP_INT;
+  result->as.integer = n;
+  return 0;
+}
+int veclisp_n_fdclose(struct veclisp_scope *scope, struct veclisp_cell args, struct veclisp_cell *result) {
+  int fd;
+  if (veclisp_fd_arg(scope, args.as.pair[0], &fd, result)) return 1;
+  veclisp_unwatch(fd);
+  close(fd);
+  result->type = VECLISP_PAIR;
+  result->as.pair = NULL;
+  return 0;
+}
+ssize_t veclisp_fdport_read(void *cookie, char *buf, size_t size) {
+  ssize_t n;
+  int fd = (int)(intptr_t)cookie;
+  while ((n = read(fd, buf, size)) < 0) {
+    if (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR) return -1;
+    if (veclisp_wait_fd(fd, EPOLLIN)) return -1;
+  }
+  return n;
+}
+ssize_t veclisp_fdport_write(void *cookie, const char *buf, size_t size) {
+  ssize_t n;
+  size_t done = 0;
+  int fd = (int)(intptr_t)cookie;
+  while (done < size) {
+    if ((n = write(fd, buf + done, size - done)) >= 0) {
+      done += n;
+    } else if ((errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR)
+               || veclisp_wait_fd(fd, EPOLLOUT)) {
+      return done ? (ssize_t)done : -1;
+    }
+  }
+  return done;
+}
+int veclisp_fdport_close(void *cookie) {
+  int fd = (int)(intptr_t)cookie;
+  veclisp_unwatch(fd);
+  return close(fd);
+}
+int veclisp_n_fdport(struct veclisp_scope *scope, struct veclisp_cell args, struct veclisp_cell *result) {
+  int fd;
+  FILE *port;
+  struct veclisp_cell mode;
+  cookie_io_functions_t io = { veclisp_fdport_read, veclisp_fdport_write, NULL, veclisp_fdport_close };
+  if (veclisp_fd_arg(scope, args.as.pair[0], &fd, result)) return 1;
+  if (args.as.pair[1].type != VECLISP_PAIR || args.as.pair[1].as.pair == NULL) {
+    mode.type = VECLISP_SYM;
+    mode.as.sym = "r+";
+  } else if (veclisp_eval(scope, args.as.pair[1].as.pair[0], &mode)) {
+    *result = mode;
+    return 1;
+  }
+  if (mode.type != VECLISP_SYM) {
+    result->type = VECLISP_SYM;
+    result->as.sym = VECLISP_ERR_INVALID_NAME;
+    return 1;
+  }
+  fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+  if ((port = fopencookie((void *)(intptr_t)fd, mode.as.sym, io)) == NULL) return veclisp_errno_err(result);
+  result->type = VECLISP_INT;
+  result->as.integer = (int64_t)port;
+  return 0;
+}
+int veclisp_n_flush(struct veclisp_scope *scope, struct veclisp_cell args, struct veclisp_cell *result) {
+  struct veclisp_cell out;
+  if (args.type == VECLISP_PAIR && args.as.pair != NULL) {
+    if (veclisp_eval(scope, args.as.pair[0], &out)) {
+      *result = out;
+      return 1;
+    }
+  } else if (veclisp_scope_lookup(scope, VECLISP_OUTPORT, &out) || out.type != VECLISP_INT) {
+    out.type = VECLISP_INT;
+    out.as.integer = (int64_t)stdout;
+  }
+  if (out.type != VECLISP_INT) {
+    result->type = VECLISP_SYM;
+    result->as.sym = VECLISP_ERR_EXPECTED_INT;
+    return 1;
+  }
+  fflush((FILE *)out.as.integer);
+  result->type = VECLISP_PAIR;
+  result->as.pair = NULL;
+  return 0;
+}
+int veclisp_on_ready(struct veclisp_scope *scope, struct veclisp_cell args, int writable, struct veclisp_cell *result) {
+  int fd;
+  struct veclisp_watch *w;
+  if (veclisp_fd_arg(scope, args.as.pair[0], &fd, result)) return 1;
+  if (veclisp_eval(scope, args.as.pair[1].as.pair[0], result)) return 1;
+  w = veclisp_watch(fd);
+  veclisp_watch_set(fd, writable ? &w->on_write : &w->on_read, *result);
+  return 0;
+}
+int veclisp_n_onreadable(struct veclisp_scope *scope, struct veclisp_cell args, struct veclisp_cell *result) {
+  return veclisp_on_ready(scope, args, 0, result);
+}
+int veclisp_n_onwritable(struct veclisp_scope *scope, struct veclisp_cell args, struct veclisp_cell *result) {
+  return veclisp_on_ready(scope, args, 1, result);
+}
+/* with no timeout, run until nothing is being watched. with a timeout,
+   wait once and return the number of callbacks run. */
+int veclisp_n_eventloop(struct veclisp_scope *scope, struct veclisp_cell args, struct veclisp_cell *result) {
+  int64_t timeout, count = 0;
+  if (args.type == VECLISP_PAIR && args.as.pair != NULL) {
+    if (veclisp_eval_int(scope, args.as.pair[0], &timeout, result)) return 1;
+    if (veclisp_event_loop_once(scope, (int)timeout, &count, result)) return 1;
+  } else {
+    while (veclisp_current->event_loop.watch_count > 0 || veclisp_runnable()) {
+      if (veclisp_step(scope, -1, &count, result)) return 1;
+    }
+  }
+  result->type = VECLISP_INT;
+  result->as.integer = count;
+  return 0;
+}
+/* coroutines run on their own C stacks and are switched with ucontext.
+   only the scheduler resumes them, so every switch is between the main
+   stack and one coroutine stack; the collector is told which stack is
+   live and keeps the suspended main stack as a root meanwhile. */
+void veclisp_enqueue(struct veclisp_coroutine *co) {
+  co->next = NULL;
+  veclisp_current->scheduler.queued++;
+  if (veclisp_current->scheduler.tail == NULL) veclisp_current->scheduler.head = co;
+  else veclisp_current->scheduler.tail->next = co;
+  veclisp_current->scheduler.tail = co;
+}
+struct veclisp_coroutine *veclisp_dequeue(void) {
+  struct veclisp_coroutine *co = veclisp_current->scheduler.head;
+  if (co == NULL) return NULL;
+  if ((veclisp_current->scheduler.head = co->next) == NULL) veclisp_current->scheduler.tail = NULL;
+  veclisp_current->scheduler.queued--;
+  co->next = NULL;
+  return co;
+}
+void veclisp_wake(struct veclisp_coroutine **waiters) {
+  struct veclisp_coroutine *co, *next;
+  for (co = *waiters; co != NULL; co = next) {
+    next = co->next;
+    veclisp_enqueue(co);
+  }
+  *waiters = NULL;
+}
+void veclisp_suspend(struct veclisp_coroutine *co) {
+  char here;
+  co->sp = &here;
+  swapcontext(&co->context, &veclisp_current->scheduler.context);
+  co->sp = NULL;
+}
+struct GC_ms_entry *veclisp_mark_range(GC_word *lo, GC_word *hi, struct GC_ms_entry *msp, struct GC_ms_entry *lim) {
+  GC_word *p;
+  for (p = lo; p < hi; ++p) msp = GC_MARK_AND_PUSH((void *)*p, msp, lim, (void **)p);
+  return msp;
+}
+struct GC_ms_entry *veclisp_mark_coroutine(GC_word *addr, struct GC_ms_entry *msp, struct GC_ms_entry *lim, GC_word env) {
+  struct veclisp_coroutine *co = (struct veclisp_coroutine *)addr;
+  msp = veclisp_mark_range(addr, (GC_word *)(co + 1), msp, lim);
+  if (co->stack != NULL && co->sp != NULL)
+    msp = veclisp_mark_range((GC_word *)((GC_word)co->sp & ~(sizeof(GC_word) - 1)),
+                             (GC_word *)((char *)co->stack + VECLISP_COROUTINE_STACK), msp, lim);
+  if (co->caller_sp != NULL)
+    msp = veclisp_mark_range((GC_word *)((GC_word)co->caller_sp & ~(sizeof(GC_word) - 1)), co->caller_base, msp, lim);
+  return msp;
+}
+/* the collector's idea of where this thread's stack starts, which
+   must only change while no collection can be under way */
+void *veclisp_set_stackbottom(void *sb) {
+  GC_set_stackbottom(NULL, sb);
+  return NULL;
+}
+void *veclisp_map_stack(void) {
+  long page = sysconf(_SC_PAGESIZE);
+  char *stack = mmap(NULL, page + VECLISP_COROUTINE_STACK, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  if (stack == MAP_FAILED) return NULL;
+  if (mprotect(stack, page, PROT_NONE)) {
+    munmap(stack, page + VECLISP_COROUTINE_STACK);
+    return NULL;
+  }
+  return stack + page;
+}
+void veclisp_unmap_stack(void *stack) {
+  long page = sysconf(_SC_PAGESIZE);
+  munmap((char *)stack - page, page + VECLISP_COROUTINE_STACK);
+}
+/* a coroutine blocked for good on something nobody else can reach is
+   collected with it; its stack goes here */
+void veclisp_coroutine_free(void *obj, void *client_data) {
+  struct veclisp_coroutine *co = obj;
+  if (co->stack != NULL) veclisp_unmap_stack(co->stack);
+}
+void veclisp_resume(struct veclisp_coroutine *co) {
+  char here;
+  struct GC_stack_base sb;
+  sb.mem_base = (char *)co->stack + VECLISP_COROUTINE_STACK;
+  veclisp_current->scheduler.current = co;
+  co->caller_base = veclisp_current->scheduler.stack_base.mem_base;
+  co->caller_sp = &here;
+  GC_call_with_alloc_lock(veclisp_set_stackbottom, &sb);
+  swapcontext(&veclisp_current->scheduler.context, &co->context);
+  GC_call_with_alloc_lock(veclisp_set_stackbottom, &veclisp_current->scheduler.stack_base);
+  co->caller_sp = NULL;
+  veclisp_current->scheduler.current = NULL;
+  if (co->done) {
+    veclisp_unmap_stack(co->stack);
+    co->stack = NULL;
+  }
+}
+void veclisp_coroutine_start(void) {
+  struct veclisp_cell result;
+  struct veclisp_coroutine *co = veclisp_current->scheduler.current;
+  if (veclisp_lambda(co->scope, co->fun, co->args, &result)) veclisp_print_err(co->scope, result);
+  co->done = 1;
+  veclisp_current->scheduler.alive--;
+  veclisp_current->scheduler.stalled = 0;
+}
+int veclisp_runnable(void) {
+  return veclisp_current->scheduler.head != NULL || veclisp_current->scheduler.io_waiting > 0;
+}
+/* run one ready coroutine, or wait on descriptors if none is ready */
+int veclisp_step(struct veclisp_scope *scope, int timeout, int64_t *count, struct veclisp_cell *result) {
+  if (veclisp_current->scheduler.head != NULL) {
+    veclisp_resume(veclisp_dequeue());
+    (*count)++;
+    return 0;
+  }
+  return veclisp_event_loop_once(scope, timeout, count, result);
+}
+int veclisp_n_spawn(struct veclisp_scope *scope, struct veclisp_cell args, struct veclisp_cell *result) {
+  struct veclisp_coroutine *co = GC_generic_malloc(sizeof(*co), veclisp_coroutine_kind);
+  if (veclisp_eval(scope, args.as.pair[0], &co->fun)) {
+    *result = co->fun;
+    return 1;
+  }
+  if (veclisp_n_list(scope, args.as.pair[1], &co->args)) {
+    *result = co->args;
+    return 1;
+  }
+  if (veclisp_current->scheduler.spawned == 0) GC_get_my_stackbottom(&veclisp_current->scheduler.stack_base);
+  co->scope = &veclisp_current->root;
+  if ((co->stack = veclisp_map_stack()) == NULL) {
+    result->type = VECLISP_SYM;
+    result->as.sym = veclisp_intern(strerror(errno));
+    return 1;
+  }
+  GC_register_finalizer_no_order(co, veclisp_coroutine_free, NULL, NULL, NULL);
+  getcontext(&co->context);
+  co->context.uc_stack.ss_sp = co->stack;
+  co->context.uc_stack.ss_size = VECLISP_COROUTINE_STACK;
+  co->context.uc_link = &veclisp_current->scheduler.context;
+  makecontext(&co->context, veclisp_coroutine_start, 0);
+  veclisp_enqueue(co);
+  veclisp_current->scheduler.alive++;
+  result->type = VECLISP_INT;
+  result->as.integer = ++veclisp_current->scheduler.spawned;
+  return 0;
+}
+/* from the main program, yield gives every ready coroutine one turn */
+int veclisp_n_yield(struct veclisp_scope *scope, struct veclisp_cell args, struct veclisp_cell *result) {
+  int64_t n = 0, count = 0;
+  struct veclisp_coroutine *co = veclisp_current->scheduler.current;
+  if (co != NULL) {
+    veclisp_current->scheduler.stalled = 0;
+    veclisp_enqueue(co);
+    veclisp_suspend(co);
+  } else {
+    if (veclisp_current->scheduler.io_waiting > 0 && veclisp_event_loop_once(scope, 0, &count, result)) return 1;
+    for (co = veclisp_current->scheduler.head; co != NULL; co = co->next) ++n;
+    while (n-- > 0 && veclisp_current->scheduler.head != NULL) veclisp_resume(veclisp_dequeue());
+  }
+  result->type = VECLISP_PAIR;
+  result->as.pair = NULL;
+  return 0;
+}
+/* a coroutine that cannot use a channel goes back on the run queue and
+   counts as stalled. once every queued coroutine has stalled in a row,
+   only descriptors or other threads can unblock them. */
+int veclisp_all_stalled(void) {
+  return veclisp_current->scheduler.head != NULL
+    && veclisp_current->scheduler.stalled >= veclisp_current->scheduler.queued;
+}
+int veclisp_other_threads(void) {
+  return __atomic_load_n(&veclisp_interp_count, __ATOMIC_RELAXED) > 1
+    || __atomic_load_n(&veclisp_isolates_starting, __ATOMIC_RELAXED) > 0;
+}
+/* a few yields catch a peer that is about to act; after that the
+   sleeps double up to a millisecond, so a long wait costs no cpu */
+void veclisp_backoff(int64_t *spins) {
+  struct timespec ts;
+  if (++*spins < 16) {
+    sched_yield();
+  } else {
+    ts.tv_sec = 0;
+    ts.tv_nsec = *spins < 26 ? 1000 << (*spins - 16) : 1000000;
+    nanosleep(&ts, NULL);
+  }
+}
+/* run until every coroutine has finished or is blocked for good, and
+   return how many are left blocked */
+int veclisp_n_run(struct veclisp_scope *scope, struct veclisp_cell args, struct veclisp_cell *result) {
+  int64_t count = 0, spins = 0;
+  if (veclisp_current->scheduler.current != NULL) return veclisp_n_yield(scope, args, result);
+  while (veclisp_runnable()) {
+    if (veclisp_all_stalled()) {
+      if (veclisp_current->scheduler.io_waiting > 0) {
+        if (veclisp_event_loop_once(scope, 1, &count, result)) return 1;
+      } else if (veclisp_other_threads()) {
+        veclisp_backoff(&spins);
+      } else {
+        break;
+      }
+      veclisp_current->scheduler.stalled = 0;
+    }
+    if (veclisp_step(scope, -1, &count, result)) return 1;
+  }
+  result->type = VECLISP_INT;
+  result->as.integer = veclisp_current->scheduler.alive;
+  return 0;
+}
+int veclisp_chan_arg(struct veclisp_scope *scope, struct veclisp_cell expr, struct veclisp_chan **chan, struct veclisp_cell *result) {
+  if (veclisp_eval(scope, expr, result)) return 1;
+  if (result->type != VECLISP_CHAN) {
+    result->type = VECLISP_SYM;
+    result->as.sym = VECLISP_ERR_EXPECTED_CHAN;
+    return 1;
+  }
+  *chan = result->as.chan;
+  return 0;
+}
+/* a coroutine retries after the others have had a turn. the main
+   program runs its coroutines, or waits for other threads, and fails
+   when nothing anywhere could change the channel */
+int veclisp_chan_wait(struct veclisp_scope *scope, int64_t *spins, struct veclisp_cell *result) {
+  int64_t count = 0;
+  struct veclisp_coroutine *co = veclisp_current->scheduler.current;
+  if (co != NULL) {
+    veclisp_current->scheduler.stalled++;
+    veclisp_enqueue(co);
+    veclisp_suspend(co);
+    return 0;
+  }
+  if (veclisp_current->scheduler.head != NULL && !veclisp_all_stalled())
+    return veclisp_step(scope, -1, &count, result);
+  if (veclisp_current->scheduler.io_waiting > 0 || veclisp_current->event_loop.watch_count > 0) {
+    veclisp_current->scheduler.stalled = 0;
+    return veclisp_event_loop_once(scope, 1, &count, result);
+  }
+  if (!veclisp_other_threads()) {
+    result->type = VECLISP_SYM;
+    result->as.sym = VECLISP_ERR_DEADLOCK;
+    return 1;
+  }
+  veclisp_backoff(spins);
+  veclisp_current->scheduler.stalled = 0;
+  return 0;
+}
+int veclisp_chan_try_send(struct veclisp_chan *c, struct veclisp_cell value) {
+  int64_t pos, seq;
+  struct veclisp_chan_slot *slot;
+  pos = __atomic_load_n(&c->enqueue_pos, __ATOMIC_RELAXED);
+  for (;;) {
+    slot = &c->slots[pos & c->mask];
+    seq = __atomic_load_n(&slot->seq, __ATOMIC_ACQUIRE);
+    if (seq == pos) {
+      if (__atomic_compare_exchange_n(&c->enqueue_pos, &pos, pos + 1, 1, __ATOMIC_RELAXED, __ATOMIC_RELAXED)) break;
+    } else if (seq < pos) {
+      return 0;
+    } else {
+      pos = __atomic_load_n(&c->enqueue_pos, __ATOMIC_RELAXED);
+    }
+  }
+  slot->value = value;
+  __atomic_store_n(&slot->seq, pos + 1, __ATOMIC_RELEASE);
+  return 1;
+}
+int veclisp_chan_try_recv(struct veclisp_chan *c, struct veclisp_cell *value) {
+  int64_t pos, seq;
+  struct veclisp_chan_slot *slot;
+  pos = __atomic_load_n(&c->dequeue_pos, __ATOMIC_RELAXED);
+  for (;;) {
+    slot = &c->slots[pos & c->mask];
+    seq = __atomic_load_n(&slot->seq, __ATOMIC_ACQUIRE);
+    if (seq == pos + 1) {
+      if (__atomic_compare_exchange_n(&c->dequeue_pos, &pos, pos + 1, 1, __ATOMIC_RELAXED, __ATOMIC_RELAXED)) break;
+    } else if (seq < pos + 1) {
+      return 0;
+    } else {
+      pos = __atomic_load_n(&c->dequeue_pos, __ATOMIC_RELAXED);
+    }
+  }
+  *value = slot->value;
+  slot->value.type = VECLISP_INT;
+  __atomic_store_n(&slot->seq, pos + c->mask + 1, __ATOMIC_RELEASE);
+  return 1;
+}
+/* the capacity is rounded up to a power of two, and is at least two */
+int veclisp_n_chan(struct veclisp_scope *scope, struct veclisp_cell args, struct veclisp_cell *result) {
+  int64_t i, capacity = 2, requested = 1;
+  struct veclisp_chan *c;
+  if (args.type == VECLISP_PAIR && args.as.pair != NULL) {
+    if (veclisp_eval_int(scope, args.as.pair[0], &requested, result)) return 1;
+    if (requested < 1 || requested > ((int64_t)1 << 40)) {
+      result->type = VECLISP_SYM;
+      result->as.sym = VECLISP_ERR_OUT_OF_RANGE;
+      return 1;
+    }
+  }
+  while (capacity < requested) capacity *= 2;
+  c = GC_malloc(sizeof(*c));
+  c->mask = capacity - 1;
+  c->slots = GC_malloc(sizeof(*c->slots) * capacity);
+  for (i = 0; i < capacity; ++i) c->slots[i].seq = i;
+  result->type = VECLISP_CHAN;
+  result->as.chan = c;
+  return 0;
+}
+int veclisp_n_chansend(struct veclisp_scope *scope, struct veclisp_cell args, struct veclisp_cell *result) {
+  int64_t spins = 0;
+  struct veclisp_chan *c;
+  struct veclisp_cell value;
+  if (veclisp_chan_arg(scope, args.as.pair[0], &c, result)) return 1;
+  if (veclisp_eval(scope, args.as.pair[1].as.pair[0], &value)) {
+    *result = value;
+    return 1;
+  }
+  for (;;) {
+    if (__atomic_load_n(&c->closed, __ATOMIC_ACQUIRE)) {
+      result->type = VECLISP_SYM;
+      result->as.sym = VECLISP_ERR_CHAN_CLOSED;
+      return 1;
+    }
+    if (veclisp_chan_try_send(c, value)) break;
+    if (veclisp_chan_wait(scope, &spins, result)) return 1;
+  }
+  veclisp_current->scheduler.stalled = 0;
+  *result = value;
+  return 0;
+}
+/* receiving from a closed, drained channel gives nil */
+int veclisp_n_chanrecv(struct veclisp_scope *scope, struct veclisp_cell args, struct veclisp_cell *result) {
+  int64_t spins = 0;
+  struct veclisp_chan *c;
+  if (veclisp_chan_arg(scope, args.as.pair[0], &c, result)) return 1;
+  for (;;) {
+    if (veclisp_chan_try_recv(c, result)) break;
+    if (__atomic_load_n(&c->closed, __ATOMIC_ACQUIRE)) {
+      if (veclisp_chan_try_recv(c, result)) break;
+      result->type = VECLISP_PAIR;
+      result->as.pair = NULL;
+      return 0;
+    }
+    if (veclisp_chan_wait(scope, &spins, result)) return 1;
+  }
+  veclisp_current->scheduler.stalled = 0;
+  return 0;
+}
+int veclisp_n_chanclose(struct veclisp_scope *scope, struct veclisp_cell args, struct veclisp_cell *result) {
+  struct veclisp_chan *c;
+  if (veclisp_chan_arg(scope, args.as.pair[0], &c, result)) return 1;
+  __atomic_store_n(&c->closed, 1, __ATOMIC_RELEASE);
+  result->type = VECLISP_PAIR;
+  result->as.pair = NULL;
+  return 0;
+}
+/* an isolate evaluates a form in a fresh interpreter on its own thread.
+   the collector is shared, so the result can be handed back as is. */
+void *veclisp_isolate_main(void *arg) {
+  struct veclisp_isolate *iso = arg;
+  struct veclisp_interp *interp = veclisp_interp_new();
+  __atomic_sub_fetch(&veclisp_isolates_starting, 1, __ATOMIC_RELAXED);
+  iso->failed = veclisp_eval(&interp->root, iso->form, &iso->result);
+  veclisp_interp_free(interp);
+  return NULL;
+}
+/* an isolate dropped without being joined still has its thread reaped */
+void veclisp_isolate_detach(void *obj, void *client_data) {
+  struct veclisp_isolate *iso = obj;
+  if (!iso->joined) pthread_detach(iso->thread);
+}
+/* (run-isolate FORM) is a handle that join-isolate turns into FORM's
+   value. the handle is only trusted once found in veclisp_isolates. */
+int veclisp_n_runisolate(struct veclisp_scope *scope, struct veclisp_cell args, struct veclisp_cell *result) {
+  int err;
+  struct veclisp_isolate *iso = GC_malloc(sizeof(*iso));
+  if (veclisp_eval(scope, args.as.pair[0], &iso->form)) {
+    *result = iso->form;
+    return 1;
+  }
+  __atomic_add_fetch(&veclisp_isolates_starting, 1, __ATOMIC_RELAXED);
+  if ((err = pthread_create(&iso->thread, NULL, veclisp_isolate_main, iso))) {
+    __atomic_sub_fetch(&veclisp_isolates_starting, 1, __ATOMIC_RELAXED);
+    errno = err;
+    result->type = VECLISP_SYM;
+    result->as.sym = veclisp_intern(strerror(errno));
+    return 1;
+  }
+  GC_register_finalizer(iso, veclisp_isolate_detach, NULL, NULL, NULL);
+  pthread_mutex_lock(&veclisp_isolates_lock);
+  veclisp_ptrmap_put(&veclisp_isolates, iso, iso);
+  pthread_mutex_unlock(&veclisp_isolates_lock);
+  result->type = VECLISP_INT;
+  result->as.integer = (int64_t)iso;
+  return 0;
+}
+int veclisp_n_joinisolate(struct veclisp_scope *scope, struct veclisp_cell args, struct veclisp_cell *result) {
+  struct veclisp_cell handle;
+  struct veclisp_isolate *iso = NULL;
+  if (veclisp_eval(scope, args.as.pair[0], &handle)) {
+    *result = handle;
+    return 1;
+  }
+  if (handle.type == VECLISP_INT) {
+    pthread_mutex_lock(&veclisp_isolates_lock);
+    iso = veclisp_ptrmap_get(&veclisp_isolates, (void *)handle.as.integer);
+    pthread_mutex_unlock(&veclisp_isolates_lock);
+  }
+  if (iso == NULL) {
+    result->type = VECLISP_SYM;
+    result->as.sym = VECLISP_ERR_EXPECTED_ISOLATE;
+    return 1;
+  }
+  if (__atomic_exchange_n(&iso->joined, 1, __ATOMIC_ACQ_REL)) {
+    result->type = VECLISP_SYM;
+    result->as.sym = VECLISP_ERR_ISOLATE_JOINED;
+    return 1;
+  }
+  pthread_join(iso->thread, NULL);
+  *result = iso->result;
+  return iso->failed;
+}
+/* the position in table of the first chunk that does not end at or
+   below p */
+int64_t veclisp_frozen_find(struct veclisp_frozen_table *table, char *p) {
+  int64_t lo = 0, hi = table == NULL ? 0 : table->count, mid;
+  while (lo < hi) {
+    mid = lo + (hi - lo) / 2;
+    if (table->chunks[mid].end <= p) lo = mid + 1;
+    else hi = mid;
+  }
+  return lo;
+}
+/* publishes a copy of the table with chunk put in, or taken out when
+   end is NULL. called with the lock held. */
+int veclisp_frozen_update(char *start, char *end) {
+  struct veclisp_frozen_table *old, *table;
+  int64_t i, count;
+  /* finalizers may run inside the allocation, so the old table is only
+     read after it */
+  count = veclisp_frozen.table == NULL ? 0 : veclisp_frozen.table->count;
+  table = GC_malloc_atomic(sizeof(*table) + sizeof(*table->chunks) * (count + 1));
+  if (table == NULL) return 1;
+  old = veclisp_frozen.table;
+  count = old == NULL ? 0 : old->count;
+  i = veclisp_frozen_find(old, start);
+  if (end == NULL && (i == count || old->chunks[i].start != start)) return 0;
+  if (i > 0) memcpy(table->chunks, old->chunks, sizeof(*table->chunks) * i);
+  if (end != NULL) {
+    table->chunks[i].start = start;
+    table->chunks[i].end = end;
+    if (i < count) memcpy(&table->chunks[i + 1], &old->chunks[i], sizeof(*table->chunks) * (count - i));
+    table->count = count + 1;
+  } else {
+    memcpy(&table->chunks[i], &old->chunks[i + 1], sizeof(*table->chunks) * (count - i - 1));
+    table->count = count - 1;
+  }
+  __atomic_store_n(&veclisp_frozen.table, table, __ATOMIC_RELEASE);
+  return 0;
+}
+void veclisp_frozen_release(void *chunk, void *client_data) {
+  pthread_mutex_lock(&veclisp_frozen.lock);
+  veclisp_frozen_update(chunk, NULL);
+  pthread_mutex_unlock(&veclisp_frozen.lock);
+}
+void *veclisp_frozen_alloc(size_t size) {
+  char *chunk, *p;
+  size_t chunk_size;
+  size = (size + 15) & ~(size_t)15;
+  if (veclisp_frozen.next == NULL || veclisp_frozen.next + size > veclisp_frozen.end) {
+    if (veclisp_frozen.table != NULL && veclisp_frozen.table->count >= VECLISP_FROZEN_MAX_CHUNKS) return NULL;
+    chunk_size = size > VECLISP_FROZEN_CHUNK ? size : VECLISP_FROZEN_CHUNK;
+    if ((chunk = GC_malloc(chunk_size)) == NULL) return NULL;
+    if (veclisp_frozen_update(chunk, chunk + chunk_size)) return NULL;
+    GC_register_finalizer_no_order(chunk, veclisp_frozen_release, NULL, NULL, NULL);
+    veclisp_frozen.next = chunk;
+    veclisp_frozen.end = chunk + chunk_size;
+  }
+  p = veclisp_frozen.next;
+  veclisp_frozen.next += size;
+  return p;
+}
+int veclisp_frozen_p(void *p) {
+  struct veclisp_frozen_table *table = __atomic_load_n(&veclisp_frozen.table, __ATOMIC_ACQUIRE);
+  int64_t i = veclisp_frozen_find(table, p);
+  return table != NULL && i < table->count && (char *)p >= table->chunks[i].start;
+}
+/* copies the graph reachable from value into the frozen chunks. shared
+   structure and cycles are preserved through the seen map. */
+int veclisp_freeze(struct veclisp_ptrmap *seen, struct veclisp_cell value, struct veclisp_cell *result) {
+  int64_t i, len;
+  struct veclisp_cell *copy;
+  struct veclisp_bytes *b;
+  for (;;) {
+    *result = value;
+    switch (value.type) {
+    case VECLISP_INT:
+    case VECLISP_SYM:
+    case VECLISP_CHAN:
+      return 0;
+    case VECLISP_LAZY:
+      result->type = VECLISP_SYM;
+      result->as.sym = VECLISP_ERR_CANNOT_FREEZE;
+      return 1;
+    case VECLISP_BYTES:
+      if (veclisp_frozen_p(value.as.bytes)) return 0;
+      if ((b = veclisp_ptrmap_get(seen, value.as.bytes)) == NULL) {
+        if ((b = veclisp_frozen_alloc(sizeof(*b) + value.as.bytes->length)) == NULL) goto full;
+        b->length = b->capacity = value.as.bytes->length;
+        b->data = (unsigned char *)(b + 1);
+        b->flags = VECLISP_BYTES_READONLY;
+        b->owner = NULL;
+        memcpy(b->data, value.as.bytes->data, b->length);
+        veclisp_ptrmap_put(seen, value.as.bytes, b);
+      }
+      result->as.bytes = b;
+      return 0;
+    case VECLISP_VEC:
+      if (veclisp_frozen_p(value.as.vec)) return 0;
+      if ((copy = veclisp_ptrmap_get(seen, value.as.vec)) != NULL) {
+        result->as.vec = copy;
+        return 0;
+      }
+      len = VECLISP_VLEN(value.as.vec);
+      if ((copy = veclisp_frozen_alloc(sizeof(*copy) * (len + 1))) == NULL) goto full;
+      veclisp_ptrmap_put(seen, value.as.vec, copy);
+      copy[0].type = VECLISP_INT;
+      copy[0].as.integer = len;
+      for (i = 1; i <= len; ++i) {
+        if (veclisp_freeze(seen, VECLISP_VELEMS(value.as.vec)[i], &copy[i])) {
+          *result = copy[i];
+          return 1;
+        }
+      }
+      result->as.vec = copy;
+      return 0;
+    case VECLISP_PAIR:
+      if (value.as.pair == NULL || veclisp_frozen_p(value.as.pair)) return 0;
+      if ((copy = veclisp_ptrmap_get(seen, value.as.pair)) != NULL) {
+        result->as.pair = copy;
+        return 0;
+      }
+      if ((copy = veclisp_frozen_alloc(sizeof(*copy) * 2)) == NULL) goto full;
+      veclisp_ptrmap_put(seen, value.as.pair, copy);
+      result->as.pair = copy;
+      if (veclisp_freeze(seen, value.as.pair[0], &copy[0])) {
+        *result = copy[0];
+        return 1;
+      }
+      /* walk down the tail instead of recursing, so long lists are fine */
+      value = value.as.pair[1];
+      result = &copy[1];
+      break;
+    }
+  }
+ full:
+  result->type = VECLISP_SYM;
+  result->as.sym = VECLISP_ERR_FROZEN_FULL;
+  return 1;
+}
+/* a frozen value can be shared between threads as is: mutating it is
+   an error */
+int veclisp_n_freeze(struct veclisp_scope *scope, struct veclisp_cell args, struct veclisp_cell *result) {
+  int failed;
+  struct veclisp_cell value;
+  struct veclisp_ptrmap seen = { 0, 0, NULL };
+  if (veclisp_eval(scope, args.as.pair[0], &value)) {
+    *result = value;
+    return 1;
+  }
+  pthread_mutex_lock(&veclisp_frozen.lock);
+  failed = veclisp_freeze(&seen, value, result);
+  pthread_mutex_unlock(&veclisp_frozen.lock);
+  return failed;
+}
+int veclisp_n_frozenp(struct veclisp_scope *scope, struct veclisp_cell args, struct veclisp_cell *result) {
+  int frozen = 1;
+  if (veclisp_eval(scope, args.as.pair[0], result)) return 1;
+  switch (result->type) {
+  case VECLISP_PAIR:
+  case VECLISP_VEC:
+    frozen = result->as.pair == NULL || veclisp_frozen_p(result->as.pair);
+    break;
+  case VECLISP_BYTES:
+    frozen = veclisp_frozen_p(result->as.bytes);
+    break;
+  case VECLISP_LAZY:
+    frozen = 0;
+    break;
+  default:
+    break;
+  }
+  result->type = VECLISP_PAIR;
+  result->as.pair = NULL;
+  if (frozen) {
+    result->type = VECLISP_SYM;
+    result->as.sym = VECLISP_T;
+  }
+  return 0;
+}
+/* monotonic nanoseconds, for timing */
+int veclisp_n_clock(struct veclisp_scope *scope, struct veclisp_cell args, struct veclisp_cell *result) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  result->type = VECLISP_INT;
+  result->as.integer = (int64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+  return 0;
+}
+uint64_t veclisp_hash_cell(struct veclisp_cell value) {
+  uint64_t hash = 14695981039346656037ULL ^ value.type;
+  int64_t i;
+  struct veclisp_cell *p;
+  switch (value.type) {
+  case VECLISP_INT:
+    return (hash ^ (uint64_t)value.as.integer) * 0x9e3779b97f4a7c15ULL;
+  case VECLISP_SYM:
+    return (hash ^ ((uint64_t)value.as.sym >> 3)) * 0x9e3779b97f4a7c15ULL;
+  case VECLISP_VEC:
+    FORVEC(i, value.as.vec) hash = (hash ^ veclisp_hash_cell(VECLISP_VELEMS(value.as.vec)[i])) * 1099511628211ULL;
+    return hash;
+  case VECLISP_PAIR:
+    for (p = &value; p->type == VECLISP_PAIR && p->as.pair != NULL; p = &p->as.pair[1])
+      hash = (hash ^ veclisp_hash_cell(p->as.pair[0])) * 1099511628211ULL;
+    if (p->type != VECLISP_PAIR) hash = (hash ^ veclisp_hash_cell(*p)) * 1099511628211ULL;
+    return hash;
+  case VECLISP_BYTES:
+    for (i = 0; i < value.as.bytes->length; ++i) hash = (hash ^ value.as.bytes->data[i]) * 1099511628211ULL;
+    return hash;
+  default:
+    return (hash ^ ((uint64_t)value.as.lazy >> 4)) * 0x9e3779b97f4a7c15ULL;
+  }
+}
+void veclisp_memo_unlink(struct veclisp_memo *memo, struct veclisp_memo_entry *e) {
+  if (e->newer) e->newer->older = e->older;
+  else memo->newest = e->older;
+  if (e->older) e->older->newer = e->newer;
+  else memo->oldest = e->newer;
+}
+void veclisp_memo_push(struct veclisp_memo *memo, struct veclisp_memo_entry *e) {
+  e->newer = NULL;
+  e->older = memo->newest;
+  if (memo->newest) memo->newest->newer = e;
+  else memo->oldest = e;
+  memo->newest = e;
+}
+void veclisp_memo_evict(struct veclisp_memo *memo) {
+  struct veclisp_memo_entry *e = memo->oldest, **link;
+  veclisp_memo_unlink(memo, e);
+  for (link = &memo->buckets[e->hash & (memo->allocated - 1)]; *link != e; link = &(*link)->next);
+  *link = e->next;
+  memo->count--;
+  memo->evictions++;
+}
+void veclisp_memo_insert(struct veclisp_memo *memo, uint64_t hash, struct veclisp_cell key, struct veclisp_cell value) {
+  int64_t i;
+  struct veclisp_memo_entry *e, *next, **buckets;
+  if (memo->limit && memo->count >= memo->limit) veclisp_memo_evict(memo);
+  if (memo->count >= memo->allocated) {
+    buckets = GC_malloc(sizeof(*buckets) * memo->allocated * 2);
+    for (i = 0; i < memo->allocated; ++i) {
+      for (e = memo->buckets[i]; e != NULL; e = next) {
+        next = e->next;
+        e->next = buckets[e->hash & (memo->allocated * 2 - 1)];
+        buckets[e->hash & (memo->allocated * 2 - 1)] = e;
+      }
+    }
+    memo->buckets = buckets;
+    memo->allocated *= 2;
+  }
+  e = GC_malloc(sizeof(*e));
+  e->hash = hash;
+  e->key = key;
+  e->value = value;
+  e->next = memo->buckets[hash & (memo->allocated - 1)];
+  memo->buckets[hash & (memo->allocated - 1)] = e;
+  veclisp_memo_push(memo, e);
+  memo->count++;
+}
+int veclisp_memo_call(struct veclisp_scope *scope, struct veclisp_cell data, struct veclisp_cell args, struct veclisp_cell *result) {
+  struct veclisp_memo *memo = (struct veclisp_memo *)data.as.integer;
+  struct veclisp_memo_entry *e;
+  uint64_t hash = veclisp_hash_cell(args);
+  FORNEXT(e, memo->buckets[hash & (memo->allocated - 1)]) {
+    if (e->hash == hash && veclisp_compare(e->key, args) == 0) {
+      memo->hits++;
+      if (e != memo->newest) {
+        veclisp_memo_unlink(memo, e);
+        veclisp_memo_push(memo, e);
+      }
+      *result = e->value;
+      return 0;
+    }
+  }
+  memo->misses++;
+  if (veclisp_lambda(scope, memo->fun, args, result)) return 1;
+  veclisp_memo_insert(memo, hash, args, *result);
+  return 0;
+}
+/* (memoize F [LIMIT]) caches F by the structure of its arguments. with
+   a limit, the least recently used entry makes room for a new one. */
+int veclisp_n_memoize(struct veclisp_scope *scope, struct veclisp_cell args, struct veclisp_cell *result) {
+  struct veclisp_memo *memo = GC_malloc(sizeof(*memo));
+  if (veclisp_eval(scope, args.as.pair[0], &memo->fun)) {
+    *result = memo->fun;
+    return 1;
+  }
+  if (args.as.pair[1].type == VECLISP_PAIR && args.as.pair[1].as.pair != NULL) {
+    if (veclisp_eval_int(scope, args.as.pair[1].as.pair[0], &memo->limit, result)) return 1;
+    if (memo->limit < 0) {
+      result->type = VECLISP_SYM;
+      result->as.sym = VECLISP_ERR_OUT_OF_RANGE;
+      return 1;
+    }
+  }
+  memo->allocated = 64;
+  memo->buckets = GC_malloc(sizeof(*memo->buckets) * memo->allocated);
+  result->type = VECLISP_PAIR;
+  result->as.pair = veclisp_alloc_pair();
+  result->as.pair[0].type = result->as.pair[1].type = VECLISP_INT;
+  result->as.pair[0].as.integer = (int64_t)veclisp_memo_call;
+  result->as.pair[1].as.integer = (int64_t)memo;
+  return 0;
+}
+/* (memo-stats M) is (hits misses entries evictions) */
+int veclisp_n_memostats(struct veclisp_scope *scope, struct veclisp_cell args, struct veclisp_cell *result) {
+  struct veclisp_cell fun, *p;
+  struct veclisp_memo *memo;
+  int64_t stats[4], i;
+  if (veclisp_eval(scope, args.as.pair[0], &fun)) {
+    *result = fun;
+    return 1;
+  }
+  if (fun.type != VECLISP_PAIR || fun.as.pair == NULL || fun.as.pair[0].type != VECLISP_INT
+      || fun.as.pair[0].as.integer != (int64_t)veclisp_memo_call) {
+    result->type = VECLISP_SYM;
+    result->as.sym = VECLISP_ERR_EXPECTED_MEMO;
+    return 1;
+  }
+  memo = (struct veclisp_memo *)fun.as.pair[1].as.integer;
+  stats[0] = memo->hits;
+  stats[1] = memo->misses;
+  stats[2] = memo->count;
+  stats[3] = memo->evictions;
+  result->type = VECLISP_PAIR;
+  result->as.pair = veclisp_alloc_pair();
+  for (i = 0, p = result; i < 4; ++i) {
+    p->as.pair[0].type = VECLISP_INT;
+    p->as.pair[0].as.integer = stats[i];
+    p->as.pair[1].type = VECLISP_PAIR;
+    p->as.pair[1].as.pair = i < 3 ? veclisp_alloc_pair() : NULL;
+    p = &p->as.pair[1];
+  }
+  return 0;
+}
+/* constant folding. (optimize F) returns F with every call to a pure
+   arithmetic or comparison native on constant arguments replaced by its
+   value, and every if on a constant test replaced by the branch taken,
+   looking only inside the arguments of natives known to evaluate them.
+   an operator is only folded while its symbol has never been bound
+   anywhere but globally to the native; the folded symbols are flagged,
+   and binding one of them later sends every optimized function back to
+   its original body, so folding stays sound under dynamic scoping. */
+int veclisp_pure_native(int64_t fn) {
+  return fn == (int64_t)veclisp_n_add || fn == (int64_t)veclisp_n_sub || fn == (int64_t)veclisp_n_mul
+    || fn == (int64_t)veclisp_n_div || fn == (int64_t)veclisp_n_mod || fn == (int64_t)veclisp_n_exp
+    || fn == (int64_t)veclisp_n_rsh || fn == (int64_t)veclisp_n_lsh || fn == (int64_t)veclisp_n_bitwiseand
+    || fn == (int64_t)veclisp_n_bitwiseor || fn == (int64_t)veclisp_n_bitwisexor || fn == (int64_t)veclisp_n_bitwisenot
+    || fn == (int64_t)veclisp_n_abs || fn == (int64_t)veclisp_n_max || fn == (int64_t)veclisp_n_min
+    || fn == (int64_t)veclisp_n_cmp || fn == (int64_t)veclisp_n_eq || fn == (int64_t)veclisp_n_gt
+    || fn == (int64_t)veclisp_n_lt || fn == (int64_t)veclisp_n_gte || fn == (int64_t)veclisp_n_lte;
+}
+/* the first argument position from which a native evaluates every
+   argument, or 0. folding only descends into those arguments: any other
+   head, a fexpr or a lambda taking its arguments whole among them, could
+   see its arguments unevaluated, where a folded form would show. */
+int veclisp_fold_args_from(int64_t fn) {
+  if (veclisp_pure_native(fn) || fn == (int64_t)veclisp_n_if || fn == (int64_t)veclisp_n_begin
+      || fn == (int64_t)veclisp_n_while || fn == (int64_t)veclisp_n_list || fn == (int64_t)veclisp_n_pair
+      || fn == (int64_t)veclisp_n_head || fn == (int64_t)veclisp_n_tail || fn == (int64_t)veclisp_n_print
+      || fn == (int64_t)veclisp_n_write || fn == (int64_t)veclisp_n_set)
+    return 1;
+  /* past the binding list */
+  if (fn == (int64_t)veclisp_n_let || fn == (int64_t)veclisp_n_dotimes) return 2;
+  return 0;
+}
+/* flags the operator of a folded form, or moves the epoch on if it was
+   rebound since folding checked it */
+void veclisp_fold_flag(char *sym) {
+  if (veclisp_sym_flag(sym, VECLISP_SYM_FOLDED) & VECLISP_SYM_REBOUND)
+    __atomic_add_fetch(&veclisp_fold_epoch, 1, __ATOMIC_RELAXED);
+}
+/* the native a symbol names, if folding may rely on it */
+int64_t veclisp_foldable_op(struct veclisp_cell head) {
+  struct veclisp_cell fn;
+  if (head.type != VECLISP_SYM || (((unsigned char *)head.as.sym)[-1] & VECLISP_SYM_REBOUND)) return 0;
+  if (veclisp_scope_lookup(&veclisp_current->root, head.as.sym, &fn) || fn.type != VECLISP_INT) return 0;
+  return fn.as.integer;
+}
+int veclisp_fold_const(struct veclisp_cell form, struct veclisp_cell *value) {
+  if (form.type == VECLISP_INT || (form.type == VECLISP_PAIR && form.as.pair == NULL)) {
+    *value = form;
+    return 1;
+  }
+  if (form.type == VECLISP_PAIR && form.as.pair[0].type == VECLISP_SYM && form.as.pair[0].as.sym == VECLISP_QUOTE
+      && veclisp_foldable_op(form.as.pair[0]) == (int64_t)veclisp_n_quote) {
+    *value = form.as.pair[1];
+    return 1;
+  }
+  return 0;
+}
+struct veclisp_cell veclisp_fold_quote(struct veclisp_cell value) {
+  struct veclisp_cell form;
+  if (value.type == VECLISP_INT || (value.type == VECLISP_PAIR && value.as.pair == NULL)) return value;
+  form.type = VECLISP_PAIR;
+  form.as.pair = veclisp_alloc_pair();
+  form.as.pair[0].type = VECLISP_SYM;
+  form.as.pair[0].as.sym = VECLISP_QUOTE;
+  form.as.pair[1] = value;
+  return form;
+}
+/* a form whose evaluation calls nothing, so nothing it runs can read @ */
+int veclisp_fold_callfree(struct veclisp_cell form) {
+  struct veclisp_cell value;
+  int64_t i;
+  switch (form.type) {
+  case VECLISP_SYM: return form.as.sym != VECLISP_AT;
+  case VECLISP_PAIR: return veclisp_fold_const(form, &value);
+  case VECLISP_VEC:
+    FORVEC(i, form.as.vec) if (!veclisp_fold_callfree(VECLISP_VELEMS(form.as.vec)[i])) return 0;
+    return 1;
+  default: return 1;
+  }
+}
+struct veclisp_cell veclisp_fold(struct veclisp_cell form, int *changed) {
+  struct veclisp_cell folded, *f, *a, value;
+  int64_t op, i, from, all_const = 1;
+  if (form.type == VECLISP_VEC) {
+    folded.type = VECLISP_VEC;
+    folded.as.vec = veclisp_alloc_vec(VECLISP_VLEN(form.as.vec));
+    FORVEC(i, form.as.vec) folded.as.vec[i] = veclisp_fold(VECLISP_VELEMS(form.as.vec)[i], changed);
+    return folded;
+  }
+  if (form.type != VECLISP_PAIR || form.as.pair == NULL) return form;
+  op = veclisp_foldable_op(form.as.pair[0]);
+  if ((from = veclisp_fold_args_from(op)) == 0) return form;
+  folded.type = VECLISP_PAIR;
+  folded.as.pair = veclisp_alloc_pair();
+  folded.as.pair[0] = form.as.pair[0];
+  f = &folded;
+  i = 1;
+  FORPAIR(a, &form.as.pair[1]) {
+    f->as.pair[1].type = VECLISP_PAIR;
+    f->as.pair[1].as.pair = veclisp_alloc_pair();
+    f = &f->as.pair[1];
+    f->as.pair[0] = i++ < from ? a->as.pair[0] : veclisp_fold(a->as.pair[0], changed);
+    if (!veclisp_fold_const(f->as.pair[0], &value)) all_const = 0;
+  }
+  f->as.pair[1] = *a;
+  if (a->type != VECLISP_PAIR) return folded;
+  if (op == (int64_t)veclisp_n_if && folded.as.pair[1].type == VECLISP_PAIR && folded.as.pair[1].as.pair != NULL
+      && veclisp_fold_const(folded.as.pair[1].as.pair[0], &value)) {
+    /* the branch taken, or anything it calls, may read the test
+       through @, so only a branch that calls nothing replaces the if */
+    a = &folded.as.pair[1].as.pair[1];
+    if (!(value.type == VECLISP_PAIR && value.as.pair == NULL)) value = a->as.pair != NULL ? a->as.pair[0] : *a;
+    else if (a->as.pair != NULL && a->as.pair[1].type == VECLISP_PAIR && a->as.pair[1].as.pair != NULL) value = a->as.pair[1].as.pair[0];
+    else {
+      value.type = VECLISP_PAIR;
+      value.as.pair = NULL;
+    }
+    if (!veclisp_fold_callfree(value)) return folded;
+    veclisp_fold_flag(form.as.pair[0].as.sym);
+    *changed = 1;
+    return value;
+  }
+  if (!all_const || !veclisp_pure_native(op)) return folded;
+  if (op == (int64_t)veclisp_n_div || op == (int64_t)veclisp_n_mod) {
+    FORPAIR(a, &folded.as.pair[1].as.pair[1])
+      if (a->as.pair[0].type != VECLISP_INT || a->as.pair[0].as.integer == 0) return folded;
+  }
+  if (veclisp_eval(&veclisp_current->root, folded, &value)) return folded;
+  veclisp_fold_flag(form.as.pair[0].as.sym);
+  *changed = 1;
+  return veclisp_fold_quote(value);
+}
+/* an optimized function is the closure (veclisp_optimized_call . [ORIGINAL FOLDED EPOCH]) */
+int veclisp_optimized_call(struct veclisp_scope *scope, struct veclisp_cell data, struct veclisp_cell args, struct veclisp_cell *result) {
+  if (data.as.vec[3].as.integer == __atomic_load_n(&veclisp_fold_epoch, __ATOMIC_RELAXED))
+    return veclisp_lambda(scope, data.as.vec[2], args, result);
+  return veclisp_lambda(scope, data.as.vec[1], args, result);
+}
+int veclisp_n_optimize(struct veclisp_scope *scope, struct veclisp_cell args, struct veclisp_cell *result) {
+  struct veclisp_cell fun, folded, *a, *f;
+  int changed = 0;
+  int64_t epoch;
+  if (veclisp_eval(scope, args.as.pair[0], &fun)) {
+    *result = fun;
+    return 1;
+  }
+  *result = fun;
+  /* only lambdas whose arguments arrive evaluated can sit behind a closure */
+  if (fun.type != VECLISP_PAIR || fun.as.pair == NULL || fun.as.pair[0].type != VECLISP_PAIR
+      || fun.as.pair[0].as.pair == NULL)
+    return 0;
+  /* read before folding, so a rebind racing the fold invalidates it */
+  epoch = __atomic_load_n(&veclisp_fold_epoch, __ATOMIC_SEQ_CST);
+  folded.type = VECLISP_PAIR;
+  folded.as.pair = veclisp_alloc_pair();
+  folded.as.pair[0] = fun.as.pair[0];
+  f = &folded;
+  FORPAIR(a, &fun.as.pair[1]) {
+    f->as.pair[1].type = VECLISP_PAIR;
+    f->as.pair[1].as.pair = veclisp_alloc_pair();
+    f = &f->as.pair[1];
+    f->as.pair[0] = veclisp_fold(a->as.pair[0], &changed);
+  }
+  f->as.pair[1] = *a;
+  if (!changed) return 0;
+  result->type = VECLISP_PAIR;
+  result->as.pair = veclisp_alloc_pair();
+  result->as.pair[0].type = VECLISP_INT;
+  result->as.pair[0].as.integer = (int64_t)veclisp_optimized_call;
+  result->as.pair[1].type = VECLISP_VEC;
+  result->as.pair[1].as.vec = veclisp_alloc_vec(3);
+  result->as.pair[1].as.vec[1] = fun;
+  result->as.pair[1].as.vec[2] = folded;
+  result->as.pair[1].as.vec[3].type = VECLISP_INT;
+  result->as.pair[1].as.vec[3].as.integer = epoch;
+  return 0;
+}
+/* lexical mode. (lexical F) compiles the lambda F into a closure that
+   keeps its parameters in slots instead of dynamic bindings. a reference
+   to a parameter of F, of an enclosing lexical lambda or of a let inside
+   one resolves here, once, to a (depth . index) slot access; any other
+   symbol, and any symbol declared special, is still looked up
+   dynamically. a nested (lexical 'G) captures the frames around it, and
+   so does a quoted lambda '((ARGS) ...) whose body refers to a slot of
+   them. other quoted and quasiquoted forms are left alone. */
+char veclisp_lexenv_mark[] = "lexenv";
+#define VECLISP_LEX_SLOT(depth, index) (((depth) << 32) | (index))
+struct veclisp_lexenv *veclisp_lexenv_of(struct veclisp_scope *scope) {
+  struct veclisp_scope *s;
+  FORNEXT(s, scope) {
+    if (s->bindings && s->bindings[0].sym == veclisp_lexenv_mark) return (struct veclisp_lexenv *)s->bindings[0].value.as.integer;
+  }
+  return NULL;
+}
+int veclisp_special_p(char *sym) {
+  return (((unsigned char *)sym)[-1] & VECLISP_SYM_SPECIAL) != 0;
+}
+/* the slot sym takes among names, or -1 */
+int64_t veclisp_lex_index(struct veclisp_cell names, char *sym) {
+  int64_t i = 0;
+  struct veclisp_cell *n;
+  if (names.type == VECLISP_SYM) return names.as.sym == sym ? 0 : -1;
+  FORPAIR(n, &names) {
+    if (veclisp_special_p(n->as.pair[0].as.sym)) continue;
+    if (n->as.pair[0].as.sym == sym) return i;
+    ++i;
+  }
+  return -1;
+}
+int64_t veclisp_lex_resolve(struct veclisp_lexlevel *level, char *sym) {
+  int64_t depth, index;
+  if (veclisp_special_p(sym)) return -1;
+  for (depth = 0; level != NULL; level = level->up, ++depth) {
+    if ((index = veclisp_lex_index(level->names, sym)) >= 0) return VECLISP_LEX_SLOT(depth, index);
+  }
+  return -1;
+}
+/* the native a call's head names when it is compiled, if any */
+int64_t veclisp_lex_op(struct veclisp_lexlevel *level, struct veclisp_cell head) {
+  struct veclisp_cell fn;
+  if (head.type != VECLISP_SYM || veclisp_lex_resolve(level, head.as.sym) >= 0) return 0;
+  if (veclisp_scope_lookup(&veclisp_current->root, head.as.sym, &fn) || fn.type != VECLISP_INT) return 0;
+  return fn.as.integer;
+}
+int veclisp_lex_quoted(struct veclisp_lexlevel *level, struct veclisp_cell form, struct veclisp_cell *quoted) {
+  if (form.type != VECLISP_PAIR || form.as.pair == NULL) return 0;
+  if (veclisp_lex_op(level, form.as.pair[0]) != (int64_t)veclisp_n_quote) return 0;
+  *quoted = form.as.pair[1];
+  return 1;
+}
+struct veclisp_cell veclisp_lex_form(veclisp_native_func op, struct veclisp_cell data) {
+  struct veclisp_cell form;
+  form.type = VECLISP_PAIR;
+  form.as.pair = veclisp_alloc_pair();
+  form.as.pair[0].type = VECLISP_INT;
+  form.as.pair[0].as.integer = (int64_t)op;
+  form.as.pair[1] = data;
+  return form;
+}
+int veclisp_lex_compile(struct veclisp_lexlevel *level, struct veclisp_cell form, struct veclisp_cell *result);
+int veclisp_lex_compile_list(struct veclisp_lexlevel *level, struct veclisp_cell list, struct veclisp_cell *result) {
+  struct veclisp_cell *a, *r = result;
+  FORPAIR(a, &list) {
+    r->type = VECLISP_PAIR;
+    r->as.pair = veclisp_alloc_pair();
+    if (veclisp_lex_compile(level, a->as.pair[0], &r->as.pair[0])) {
+      *result = r->as.pair[0];
+      return 1;
+    }
+    r = &r->as.pair[1];
+  }
+  if (veclisp_lex_compile(level, *a, r)) {
+    *result = *r;
+    return 1;
+  }
+  return 0;
+}
+/* a frame template is [NAMES BODY SLOTS SPECIALS CAPTURED VALUES], with
+   BODY compiled inside the frame and VALUES, a let's, outside it */
+int veclisp_lex_template(struct veclisp_lexlevel *up, struct veclisp_cell names, struct veclisp_cell body, struct veclisp_cell values, struct veclisp_cell *result) {
+  int64_t slots = 0, specials = 0;
+  struct veclisp_cell *n, *t;
+  struct veclisp_lexlevel level;
+  if (names.type == VECLISP_SYM) {
+    if (veclisp_special_p(names.as.sym)) specials = 1;
+    else slots = 1;
+  } else if (names.type == VECLISP_PAIR) {
+    FORPAIR(n, &names) {
+      if (n->as.pair[0].type != VECLISP_SYM) {
+        result->type = VECLISP_SYM;
+        result->as.sym = VECLISP_ERR_INVALID_NAME;
+        return 1;
+      }
+      if (veclisp_special_p(n->as.pair[0].as.sym)) ++specials;
+      else ++slots;
+    }
+  } else {
+    result->type = VECLISP_SYM;
+    result->as.sym = VECLISP_ERR_ILLEGAL_LAMBDA_LIST;
+    return 1;
+  }
+  level.names = names;
+  level.captured = 0;
+  level.up = up;
+  t = veclisp_alloc_vec(6);
+  t[1] = names;
+  if (veclisp_lex_compile_list(&level, body, &t[2])) {
+    *result = t[2];
+    return 1;
+  }
+  if (veclisp_lex_compile_list(up, values, &t[6])) {
+    *result = t[6];
+    return 1;
+  }
+  t[3].type = t[4].type = t[5].type = VECLISP_INT;
+  t[3].as.integer = slots;
+  t[4].as.integer = specials;
+  t[5].as.integer = level.captured;
+  result->type = VECLISP_VEC;
+  result->as.vec = t;
+  return 0;
+}
+/* whether form refers to a slot of level other than one of names */
+int veclisp_lex_free(struct veclisp_lexlevel *level, struct veclisp_cell names, struct veclisp_cell form) {
+  int64_t i;
+  switch (form.type) {
+  case VECLISP_SYM:
+    return veclisp_lex_index(names, form.as.sym) < 0 && veclisp_lex_resolve(level, form.as.sym) >= 0;
+  case VECLISP_VEC:
+    FORVEC(i, form.as.vec) {
+      if (veclisp_lex_free(level, names, VECLISP_VELEMS(form.as.vec)[i])) return 1;
+    }
+    return 0;
+  case VECLISP_PAIR:
+    return form.as.pair != NULL && (veclisp_lex_free(level, names, form.as.pair[0]) || veclisp_lex_free(level, names, form.as.pair[1]));
+  default:
+    return 0;
+  }
+}
+/* whether quoted is a lambda '((ARGS) ...) that uses a slot of level */
+int veclisp_lex_lambda(struct veclisp_lexlevel *level, struct veclisp_cell quoted) {
+  struct veclisp_cell *n;
+  if (level == NULL || quoted.type != VECLISP_PAIR || quoted.as.pair == NULL) return 0;
+  if (quoted.as.pair[0].type != VECLISP_PAIR || quoted.as.pair[0].as.pair == NULL) return 0;
+  FORPAIR(n, &quoted.as.pair[0]) {
+    if (n->as.pair[0].type != VECLISP_SYM) return 0;
+  }
+  return veclisp_lex_free(level, quoted.as.pair[0], quoted.as.pair[1]);
+}
+int veclisp_n_lexset(struct veclisp_scope *scope, struct veclisp_cell args, struct veclisp_cell *result);
+int veclisp_n_lexlet(struct veclisp_scope *scope, struct veclisp_cell args, struct veclisp_cell *result);
+int veclisp_n_lexclosure(struct veclisp_scope *scope, struct veclisp_cell args, struct veclisp_cell *result);
+int veclisp_lex_compile(struct veclisp_lexlevel *level, struct veclisp_cell form, struct veclisp_cell *result) {
+  int64_t i, op, slot;
+  struct veclisp_cell *a, *b, *n, *v, quoted, data, names, values;
+  struct veclisp_lexlevel *l;
+  *result = form;
+  switch (form.type) {
+  case VECLISP_SYM:
+    if ((slot = veclisp_lex_resolve(level, form.as.sym)) >= 0) {
+      data.type = VECLISP_INT;
+      data.as.integer = slot;
+      *result = veclisp_lex_form(veclisp_n_lexref, data);
+    }
+    return 0;
+  case VECLISP_VEC:
+    if (veclisp_vec_const(form.as.vec)) return 0;
+    result->as.vec = veclisp_alloc_vec(VECLISP_VLEN(form.as.vec));
+    FORVEC(i, form.as.vec) {
+      if (veclisp_lex_compile(level, VECLISP_VELEMS(form.as.vec)[i], &result->as.vec[i])) {
+        *result = result->as.vec[i];
+        return 1;
+      }
+    }
+    return 0;
+  case VECLISP_PAIR:
+    if (form.as.pair == NULL) return 0;
+    break;
+  default:
+    return 0;
+  }
+  op = veclisp_lex_op(level, form.as.pair[0]);
+  a = &form.as.pair[1];
+  if ((op == (int64_t)veclisp_n_quote && veclisp_lex_lambda(level, quoted = *a))
+      || (op == (int64_t)veclisp_n_lexical && a->type == VECLISP_PAIR && a->as.pair != NULL
+          && veclisp_lex_quoted(level, a->as.pair[0], &quoted) && quoted.type == VECLISP_PAIR && quoted.as.pair != NULL)) {
+    for (l = level; l != NULL; l = l->up) l->captured = 1;
+    if (veclisp_lex_template(level, quoted.as.pair[0], quoted.as.pair[1], veclisp_nil(), &data)) {
+      *result = data;
+      return 1;
+    }
+    *result = veclisp_lex_form(veclisp_n_lexclosure, data);
+    return 0;
+  }
+  if (op == (int64_t)veclisp_n_quote || op == (int64_t)veclisp_n_quasiquote) return 0;
+  if (op == (int64_t)veclisp_n_let && a->type == VECLISP_PAIR && a->as.pair != NULL) {
+    names = values = veclisp_nil();
+    n = &names;
+    v = &values;
+    FORPAIR(b, &a->as.pair[0]) {
+      n->type = v->type = VECLISP_PAIR;
+      n->as.pair = veclisp_alloc_pair();
+      v->as.pair = veclisp_alloc_pair();
+      n->as.pair[0] = b->as.pair[0];
+      b = &b->as.pair[1];
+      v->as.pair[0] = b->type == VECLISP_PAIR && b->as.pair != NULL ? b->as.pair[0] : veclisp_nil();
+      n = &n->as.pair[1];
+      v = &v->as.pair[1];
+      *n = *v = veclisp_nil();
+      if (b->type != VECLISP_PAIR || b->as.pair == NULL) break;
+    }
+    if (veclisp_lex_template(level, names, a->as.pair[1], values, &data)) {
+      *result = data;
+      return 1;
+    }
+    *result = veclisp_lex_form(veclisp_n_lexlet, data);
+    return 0;
+  }
+  if (op == (int64_t)veclisp_n_set && a->type == VECLISP_PAIR && a->as.pair != NULL
+      && veclisp_lex_quoted(level, a->as.pair[0], &quoted) && quoted.type == VECLISP_SYM
+      && (slot = veclisp_lex_resolve(level, quoted.as.sym)) >= 0
+      && a->as.pair[1].type == VECLISP_PAIR && a->as.pair[1].as.pair != NULL) {
+    data.type = VECLISP_PAIR;
+    data.as.pair = veclisp_alloc_pair();
+    data.as.pair[0].type = VECLISP_INT;
+    data.as.pair[0].as.integer = slot;
+    if (veclisp_lex_compile(level, a->as.pair[1].as.pair[0], &data.as.pair[1])) {
+      *result = data.as.pair[1];
+      return 1;
+    }
+    *result = veclisp_lex_form(veclisp_n_lexset, data);
+    return 0;
+  }
+  result->as.pair = veclisp_alloc_pair();
+  if (veclisp_lex_compile(level, form.as.pair[0], &result->as.pair[0])) {
+    *result = result->as.pair[0];
+    return 1;
+  }
+  if (veclisp_lex_compile_list(level, form.as.pair[1], &result->as.pair[1])) {
+    *result = result->as.pair[1];
+    return 1;
+  }
+  return 0;
+}
+/* binds the names of tmpl to values in a new frame below up and runs
+   its body. special names are bound dynamically beside the marker. */
+int veclisp_lex_enter(struct veclisp_scope *scope, struct veclisp_cell *tmpl, struct veclisp_lexenv *up, struct veclisp_cell values, int evaluate, struct veclisp_cell *result) {
+  int64_t k = 0;
+  struct veclisp_lexenv stack_env, *env = &stack_env;
+  struct veclisp_cell stack_slots[VECLISP_FRAME_SLOTS], value, *n, *v = &values;
+  struct veclisp_scope frame;
+  struct veclisp_bindings marks[VECLISP_FRAME_SLOTS], *b;
+  if (tmpl[5].as.integer || tmpl[3].as.integer > VECLISP_FRAME_SLOTS) {
+    env = GC_malloc(sizeof(*env) + sizeof(*env->slots) * tmpl[3].as.integer);
+    env->slots = (struct veclisp_cell *)(env + 1);
+  } else {
+    env->slots = stack_slots;
+  }
+  env->up = up;
+  b = frame.bindings = veclisp_frame(marks, tmpl[4].as.integer + 1);
+  b->sym = veclisp_lexenv_mark;
+  b->value.type = VECLISP_INT;
+  b->value.as.integer = (int64_t)env;
+  if (tmpl[1].type == VECLISP_SYM) {
+    if (veclisp_special_p(tmpl[1].as.sym)) {
+      ++b;
+      b->sym = tmpl[1].as.sym;
+      veclisp_rebind_local(b->sym);
+      b->value = values;
+    } else {
+      env->slots[0] = values;
+    }
+  } else {
+    FORPAIR(n, &tmpl[1]) {
+      value = veclisp_nil();
+      if (v->type == VECLISP_PAIR && v->as.pair != NULL) {
+        if (!evaluate) value = v->as.pair[0];
+        else if (veclisp_eval(scope, v->as.pair[0], &value)) {
+          *result = value;
+          return 1;
+        }
+        v = &v->as.pair[1];
+      }
+      if (veclisp_special_p(n->as.pair[0].as.sym)) {
+        ++b;
+        b->sym = n->as.pair[0].as.sym;
+        veclisp_rebind_local(b->sym);
+        b->value = value;
+      } else {
+        env->slots[k++] = value;
+      }
+    }
+  }
+  frame.next = scope;
+  *result = veclisp_nil();
+  FORPAIR(n, &tmpl[2]) {
+    if (veclisp_eval(&frame, n->as.pair[0], result)) return 1;
+  }
+  return 0;
+}
+int veclisp_n_lexref(struct veclisp_scope *scope, struct veclisp_cell args, struct veclisp_cell *result) {
+  struct veclisp_lexenv *env = veclisp_lexenv_of(scope);
+  int64_t depth;
+  for (depth = args.as.integer >> 32; depth > 0; --depth) env = env->up;
+  *result = env->slots[args.as.integer & 0xffffffff];
+  return 0;
+}
+int veclisp_n_lexset(struct veclisp_scope *scope, struct veclisp_cell args, struct veclisp_cell *result) {
+  struct veclisp_lexenv *env;
+  int64_t depth;
+  if (veclisp_eval(scope, args.as.pair[1], result)) return 1;
+  env = veclisp_lexenv_of(scope);
+  for (depth = args.as.pair[0].as.integer >> 32; depth > 0; --depth) env = env->up;
+  env->slots[args.as.pair[0].as.integer & 0xffffffff] = *result;
+  return 0;
+}
+int veclisp_n_lexlet(struct veclisp_scope *scope, struct veclisp_cell args, struct veclisp_cell *result) {
+  return veclisp_lex_enter(scope, args.as.vec, veclisp_lexenv_of(scope), args.as.vec[6], 1, result);
+}
+/* a lexical closure is (veclisp_lex_call . [TEMPLATE ENV]) */
+int veclisp_lex_call(struct veclisp_scope *scope, struct veclisp_cell data, struct veclisp_cell args, struct veclisp_cell *result) {
+  return veclisp_lex_enter(scope, data.as.vec[1].as.vec, (struct veclisp_lexenv *)data.as.vec[2].as.integer, args, 0, result);
+}
+struct veclisp_cell veclisp_lex_closure(struct veclisp_cell tmpl, struct veclisp_lexenv *env) {
+  struct veclisp_cell closure;
+  closure.type = VECLISP_PAIR;
+  closure.as.pair = veclisp_alloc_pair();
+  closure.as.pair[0].type = VECLISP_INT;
+  closure.as.pair[0].as.integer = (int64_t)veclisp_lex_call;
+  closure.as.pair[1].type = VECLISP_VEC;
+  closure.as.pair[1].as.vec = veclisp_alloc_vec(2);
+  closure.as.pair[1].as.vec[1] = tmpl;
+  closure.as.pair[1].as.vec[2].type = VECLISP_INT;
+  closure.as.pair[1].as.vec[2].as.integer = (int64_t)env;
+  return closure;
+}
+int veclisp_n_lexclosure(struct veclisp_scope *scope, struct veclisp_cell args, struct veclisp_cell *result) {
+  *result = veclisp_lex_closure(args, veclisp_lexenv_of(scope));
+  return 0;
+}
+/* (lexical F) is F compiled to a lexical closure, which always gets its
+   arguments evaluated. (lexical) alone makes the file being loaded
+   compile every (set 'NAME '((ARGS) ...)) that follows. */
+int veclisp_n_lexical(struct veclisp_scope *scope, struct veclisp_cell args, struct veclisp_cell *result) {
+  struct veclisp_cell fun, tmpl;
+  if (args.type != VECLISP_PAIR || args.as.pair == NULL) {
+    fun.type = VECLISP_INT;
+    fun.as.integer = 1;
+    veclisp_set(scope, VECLISP_LEXICAL, fun);
+    *result = veclisp_nil();
+    return 0;
+  }
+  if (veclisp_eval(scope, args.as.pair[0], &fun)) {
+    *result = fun;
+    return 1;
+  }
+  *result = fun;
+  if (fun.type != VECLISP_PAIR || fun.as.pair == NULL) {
+    result->type = VECLISP_SYM;
+    result->as.sym = VECLISP_ERR_ILLEGAL_LAMBDA_LIST;
+    return 1;
+  }
+  if (fun.as.pair[0].type == VECLISP_INT && fun.as.pair[0].as.integer == (int64_t)veclisp_lex_call) return 0;
+  if (veclisp_lex_template(NULL, fun.as.pair[0], fun.as.pair[1], veclisp_nil(), &tmpl)) {
+    *result = tmpl;
+    return 1;
+  }
+  *result = veclisp_lex_closure(tmpl, NULL);
+  return 0;
+}
+/* (special SYM...) keeps every SYM dynamically bound in lexical code */
+int veclisp_n_special(struct veclisp_scope *scope, struct veclisp_cell args, struct veclisp_cell *result) {
+  struct veclisp_cell *a;
+  FORPAIR(a, &args) {
+    if (a->as.pair[0].type != VECLISP_SYM) {
+      result->type = VECLISP_SYM;
+      result->as.sym = VECLISP_ERR_INVALID_NAME;
+      return 1;
+    }
+    veclisp_sym_flag(a->as.pair[0].as.sym, VECLISP_SYM_SPECIAL);
+  }
+  *result = veclisp_nil();
+  return 0;
+}
+/* rewrites (set 'NAME '((ARGS) ...)) to bind NAME to the compiled closure */
+int veclisp_lex_define(struct veclisp_cell *form, struct veclisp_cell *result) {
+  struct veclisp_cell *a, *f, name, fun, tmpl, quoted;
+  if (form->type != VECLISP_PAIR || form->as.pair == NULL) return 0;
+  if (veclisp_lex_op(NULL, form->as.pair[0]) != (int64_t)veclisp_n_set) return 0;
+  a = &form->as.pair[1];
+  if (a->type != VECLISP_PAIR || a->as.pair == NULL || !veclisp_lex_quoted(NULL, a->as.pair[0], &name)) return 0;
+  a = &a->as.pair[1];
+  if (a->type != VECLISP_PAIR || a->as.pair == NULL || !veclisp_lex_quoted(NULL, a->as.pair[0], &fun)) return 0;
+  if (fun.type != VECLISP_PAIR || fun.as.pair == NULL || fun.as.pair[0].type != VECLISP_PAIR) return 0;
+  if (veclisp_lex_template(NULL, fun.as.pair[0], fun.as.pair[1], veclisp_nil(), &tmpl)) {
+    *result = tmpl;
+    return 1;
+  }
+  quoted.type = VECLISP_PAIR;
+  quoted.as.pair = veclisp_alloc_pair();
+  quoted.as.pair[0] = a->as.pair[0].as.pair[0];
+  quoted.as.pair[1] = veclisp_lex_closure(tmpl, NULL);
+  f = veclisp_alloc_pair();
+  f[0] = form->as.pair[0];
+  f[1].type = VECLISP_PAIR;
+  f[1].as.pair = veclisp_alloc_pair();
+  f[1].as.pair[0] = form->as.pair[1].as.pair[0];
+  f[1].as.pair[1].type = VECLISP_PAIR;
+  f[1].as.pair[1].as.pair = veclisp_alloc_pair();
+  f[1].as.pair[1].as.pair[0] = quoted;
+  f[1].as.pair[1].as.pair[1] = veclisp_nil();
+  form->as.pair = f;
+  return 0;
+}
+/* (call-cache-stats) is (hits misses) of the call site caches */
+int veclisp_n_callcachestats(struct veclisp_scope *scope, struct veclisp_cell args, struct veclisp_cell *result) {
+  struct veclisp_cell *p;
+  int64_t stats[2], i;
+  stats[0] = veclisp_current->call_cache_hits;
+  stats[1] = veclisp_current->call_cache_misses;
+  result->type = VECLISP_PAIR;
+  result->as.pair = veclisp_alloc_pair();
+  for (i = 0, p = result; i < 2; ++i) {
+    p->as.pair[0].type = VECLISP_INT;
+    p->as.pair[0].as.integer = stats[i];
+    p->as.pair[1].type = VECLISP_PAIR;
+    p->as.pair[1].as.pair = i < 1 ? veclisp_alloc_pair() : NULL;
+    p = &p->as.pair[1];
+  }
+  return 0;
+}
+/* the jit. once a lambda with a list of names has been called
+   jit_threshold times its body is translated, form by form, into x86-64
+   code working on 16 byte cells in its own frame. arithmetic,
+   comparisons, if and quote are inlined; anything else calls back into
+   the interpreter. the code only runs while the natives it inlined are
+   still the global bindings of their symbols. */
+int veclisp_jit_compare(struct veclisp_cell *x, struct veclisp_cell *y) {
+  return veclisp_compare(*x, *y);
+}
+void veclisp_jit_var(struct veclisp_scope *scope, char *sym, struct veclisp_cell *result) {
+  veclisp_scope_lookup(scope, sym, result);
+}
+int veclisp_jit_eval(struct veclisp_scope *scope, struct veclisp_cell *form, struct veclisp_cell *result) {
+  return veclisp_eval(scope, *form, result);
+}
+#if defined(__x86_64__)
+enum veclisp_x64_reg
+  { VECLISP_RAX, VECLISP_RCX, VECLISP_RDX, VECLISP_RBX,
+    VECLISP_RSP, VECLISP_RBP, VECLISP_RSI, VECLISP_RDI,
+    VECLISP_R8, VECLISP_R9, VECLISP_R10, VECLISP_R11,
+    VECLISP_R12, VECLISP_R13, VECLISP_R14, VECLISP_R15,
+  };
+/* generated code keeps the current scope in r12, the lambda's bindings
+   in r13, the result cell in r14 and its frame of cells in rbx */
+struct veclisp_jit_buf {
+  unsigned char *code;
+  int64_t used, allocated, frame, max_frame, epilogue;
+  /* the cell whose value an error takes on, as the outermost native
+     in progress would leave it, or -1 for the error itself */
+  int64_t err;
+  struct veclisp_cell names;
+  struct veclisp_jit *jit;
+};
+void veclisp_jit_byte(struct veclisp_jit_buf *b, int x) {
+  if (b->used == b->allocated) {
+    b->allocated = b->allocated ? b->allocated * 2 : 1024;
+    b->code = realloc(b->code, b->allocated);
+  }
+  b->code[b->used++] = x;
+}
+void veclisp_jit_u32(struct veclisp_jit_buf *b, uint32_t x) {
+  int i;
+  for (i = 0; i < 4; ++i) veclisp_jit_byte(b, (x >> (i * 8)) & 0xff);
+}
+void veclisp_jit_u64(struct veclisp_jit_buf *b, uint64_t x) {
+  int i;
+  for (i = 0; i < 8; ++i) veclisp_jit_byte(b, (x >> (i * 8)) & 0xff);
+}
+/* op reg, [base + disp], with a 64 bit operand when wide */
+void veclisp_jit_mem(struct veclisp_jit_buf *b, int wide, const char *op, int reg, int base, int64_t disp) {
+  int rex = 0x40 | (wide << 3) | ((reg >> 3) << 2) | (base >> 3);
+  if (rex != 0x40) veclisp_jit_byte(b, rex);
+  for (; *op; ++op) veclisp_jit_byte(b, (unsigned char)*op);
+  veclisp_jit_byte(b, 0x80 | ((reg & 7) << 3) | (base & 7));
+  if ((base & 7) == VECLISP_RSP) veclisp_jit_byte(b, 0x24);
+  veclisp_jit_u32(b, (uint32_t)disp);
+}
+void veclisp_jit_load(struct veclisp_jit_buf *b, int reg, int base, int64_t disp) {
+  veclisp_jit_mem(b, 1, "\x8b", reg, base, disp);
+}
+void veclisp_jit_store(struct veclisp_jit_buf *b, int base, int64_t disp, int reg) {
+  veclisp_jit_mem(b, 1, "\x89", reg, base, disp);
+}
+void veclisp_jit_lea(struct veclisp_jit_buf *b, int reg, int base, int64_t disp) {
+  veclisp_jit_mem(b, 1, "\x8d", reg, base, disp);
+}
+void veclisp_jit_imm(struct veclisp_jit_buf *b, int reg, uint64_t x) {
+  veclisp_jit_byte(b, 0x48 | (reg >> 3));
+  veclisp_jit_byte(b, 0xb8 | (reg & 7));
+  veclisp_jit_u64(b, x);
+}
+void veclisp_jit_mov(struct veclisp_jit_buf *b, int dst, int src) {
+  veclisp_jit_byte(b, 0x48 | ((src >> 3) << 2) | (dst >> 3));
+  veclisp_jit_byte(b, 0x89);
+  veclisp_jit_byte(b, 0xc0 | ((src & 7) << 3) | (dst & 7));
+}
+void veclisp_jit_push(struct veclisp_jit_buf *b, int reg) {
+  if (reg >> 3) veclisp_jit_byte(b, 0x41);
+  veclisp_jit_byte(b, 0x50 | (reg & 7));
+}
+void veclisp_jit_pop(struct veclisp_jit_buf *b, int reg) {
+  if (reg >> 3) veclisp_jit_byte(b, 0x41);
+  veclisp_jit_byte(b, 0x58 | (reg & 7));
+}
+void veclisp_jit_call(struct veclisp_jit_buf *b, void *fun) {
+  veclisp_jit_imm(b, VECLISP_RAX, (uint64_t)fun);
+  veclisp_jit_byte(b, 0xff);
+  veclisp_jit_byte(b, 0xd0);
+}
+/* a jump or conditional jump to a later spot, returning where its
+   displacement goes. cc is the condition code, or -1 for always. */
+int64_t veclisp_jit_jump(struct veclisp_jit_buf *b, int cc) {
+  if (cc < 0) veclisp_jit_byte(b, 0xe9);
+  else {
+    veclisp_jit_byte(b, 0x0f);
+    veclisp_jit_byte(b, 0x80 | cc);
+  }
+  veclisp_jit_u32(b, 0);
+  return b->used - 4;
+}
+void veclisp_jit_land(struct veclisp_jit_buf *b, int64_t at) {
+  uint32_t rel = (uint32_t)(b->used - (at + 4));
+  memcpy(&b->code[at], &rel, 4);
+}
+void veclisp_jit_jump_back(struct veclisp_jit_buf *b, int64_t to) {
+  veclisp_jit_byte(b, 0xe9);
+  veclisp_jit_u32(b, (uint32_t)(to - (b->used + 4)));
+}
+#define VECLISP_CC_E 0x4
+#define VECLISP_CC_NE 0x5
+#define VECLISP_CC_L 0xc
+#define VECLISP_CC_GE 0xd
+#define VECLISP_CC_LE 0xe
+#define VECLISP_CC_G 0xf
+/* frame cells are handed out and given back in stack order */
+int64_t veclisp_jit_temp(struct veclisp_jit_buf *b, int64_t bytes) {
+  int64_t at = b->frame;
+  b->frame += bytes;
+  if (b->frame > b->max_frame) b->max_frame = b->frame;
+  return at;
+}
+void veclisp_jit_copy(struct veclisp_jit_buf *b, int dst, int64_t to, int src, int64_t from) {
+  veclisp_jit_load(b, VECLISP_RCX, src, from);
+  veclisp_jit_store(b, dst, to, VECLISP_RCX);
+  veclisp_jit_load(b, VECLISP_RCX, src, from + 8);
+  veclisp_jit_store(b, dst, to + 8, VECLISP_RCX);
+}
+void veclisp_jit_const(struct veclisp_jit_buf *b, int64_t t, struct veclisp_cell value) {
+  veclisp_jit_mem(b, 0, "\xc7", 0, VECLISP_RBX, t);
+  veclisp_jit_u32(b, value.type);
+  veclisp_jit_imm(b, VECLISP_RAX, (uint64_t)value.as.integer);
+  veclisp_jit_store(b, VECLISP_RBX, t + 8, VECLISP_RAX);
+}
+/* after a helper: on failure its error in t becomes the result */
+void veclisp_jit_check(struct veclisp_jit_buf *b, int64_t t) {
+  int64_t ok;
+  if (b->err >= 0) t = b->err;
+  veclisp_jit_byte(b, 0x85);
+  veclisp_jit_byte(b, 0xc0);
+  ok = veclisp_jit_jump(b, VECLISP_CC_E);
+  veclisp_jit_copy(b, VECLISP_R14, 0, VECLISP_RBX, t);
+  veclisp_jit_byte(b, 0xb8);
+  veclisp_jit_u32(b, 1);
+  veclisp_jit_jump_back(b, b->epilogue);
+  veclisp_jit_land(b, ok);
+}
+int64_t veclisp_jit_param(struct veclisp_cell names, char *sym) {
+  struct veclisp_cell *p;
+  int64_t i = 0;
+  FORPAIR(p, &names) {
+    if (p->as.pair[0].as.sym == sym) return i;
+    ++i;
+  }
+  return -1;
+}
+/* the native a call form's head would run, if it is one worth inlining
+   and only its global binding can ever be seen */
+int64_t veclisp_jit_op(struct veclisp_jit_buf *b, struct veclisp_cell head, struct veclisp_bindings **binding) {
+  int64_t op, i;
+  if (head.type != VECLISP_SYM || (((unsigned char *)head.as.sym)[-1] & VECLISP_SYM_SHADOWED)
+      || veclisp_jit_param(b->names, head.as.sym) >= 0) return 0;
+  *binding = veclisp_scope_binding(&veclisp_current->root, head.as.sym);
+  if (*binding == NULL || (*binding)->value.type != VECLISP_INT) return 0;
+  op = (*binding)->value.as.integer;
+  /* once the guards are full only bindings already guarded are inlined */
+  if (b->jit->guard_count == VECLISP_JIT_GUARDS) {
+    for (i = 0; i < b->jit->guard_count && b->jit->guards[i].binding != *binding; ++i);
+    if (i == b->jit->guard_count) return 0;
+  }
+  if (op == (int64_t)veclisp_n_quote || op == (int64_t)veclisp_n_if
+      || op == (int64_t)veclisp_n_add || op == (int64_t)veclisp_n_sub || op == (int64_t)veclisp_n_mul
+      || op == (int64_t)veclisp_n_eq || op == (int64_t)veclisp_n_lt || op == (int64_t)veclisp_n_gt
+      || op == (int64_t)veclisp_n_lte || op == (int64_t)veclisp_n_gte) return op;
+  return 0;
+}
+void veclisp_jit_guard(struct veclisp_jit_buf *b, char *sym, struct veclisp_bindings *binding) {
+  struct veclisp_jit *jit = b->jit;
+  int64_t i;
+  for (i = 0; i < jit->guard_count; ++i) {
+    if (jit->guards[i].binding == binding) return;
+  }
+  jit->guards[jit->guard_count].sym = sym;
+  jit->guards[jit->guard_count].binding = binding;
+  jit->guards[jit->guard_count].value = binding->value.as.integer;
+  jit->guard_count++;
+}
+void veclisp_jit_expr(struct veclisp_jit_buf *b, struct veclisp_cell *form, int64_t t);
+void veclisp_jit_delegate(struct veclisp_jit_buf *b, struct veclisp_cell *form, int64_t t) {
+  veclisp_jit_mov(b, VECLISP_RDI, VECLISP_R12);
+  veclisp_jit_imm(b, VECLISP_RSI, (uint64_t)form);
+  veclisp_jit_lea(b, VECLISP_RDX, VECLISP_RBX, t);
+  veclisp_jit_call(b, veclisp_jit_eval);
+  veclisp_jit_check(b, t);
+}
+void veclisp_jit_arith(struct veclisp_jit_buf *b, int64_t op, struct veclisp_cell *args, int64_t t) {
+  struct veclisp_cell *a, init;
+  int64_t x = veclisp_jit_temp(b, 16), err = b->err;
+  init.type = VECLISP_INT;
+  init.as.integer = op == (int64_t)veclisp_n_mul;
+  veclisp_jit_const(b, t, init);
+  if (err < 0) b->err = t;
+  FORPAIR(a, args) {
+    veclisp_jit_expr(b, &a->as.pair[0], x);
+    veclisp_jit_load(b, VECLISP_RAX, VECLISP_RBX, t + 8);
+    if (op == (int64_t)veclisp_n_add) veclisp_jit_mem(b, 1, "\x03", VECLISP_RAX, VECLISP_RBX, x + 8);
+    else if (op == (int64_t)veclisp_n_sub) veclisp_jit_mem(b, 1, "\x2b", VECLISP_RAX, VECLISP_RBX, x + 8);
+    else veclisp_jit_mem(b, 1, "\x0f\xaf", VECLISP_RAX, VECLISP_RBX, x + 8);
+    veclisp_jit_store(b, VECLISP_RBX, t + 8, VECLISP_RAX);
+  }
+  b->err = err;
+}
+/* two integers compare inline; anything else goes through
+   veclisp_compare. both leave flags as for comparing x with y. */
+void veclisp_jit_cmp(struct veclisp_jit_buf *b, int64_t op, struct veclisp_cell *args, int64_t t) {
+  struct veclisp_cell truth;
+  int64_t x = veclisp_jit_temp(b, 16), y = veclisp_jit_temp(b, 16), slow_x, slow_y, set, no, done;
+  int cc = op == (int64_t)veclisp_n_eq ? VECLISP_CC_E
+    : op == (int64_t)veclisp_n_lt ? VECLISP_CC_L
+    : op == (int64_t)veclisp_n_gt ? VECLISP_CC_G
+    : op == (int64_t)veclisp_n_lte ? VECLISP_CC_LE
+    : VECLISP_CC_GE;
+  veclisp_jit_expr(b, &args->as.pair[0], x);
+  veclisp_jit_expr(b, &args->as.pair[1].as.pair[0], y);
+  veclisp_jit_mem(b, 0, "\x83", 7, VECLISP_RBX, x);
+  veclisp_jit_byte(b, VECLISP_INT);
+  slow_x = veclisp_jit_jump(b, VECLISP_CC_NE);
+  veclisp_jit_mem(b, 0, "\x83", 7, VECLISP_RBX, y);
+  veclisp_jit_byte(b, VECLISP_INT);
+  slow_y = veclisp_jit_jump(b, VECLISP_CC_NE);
+  veclisp_jit_load(b, VECLISP_RAX, VECLISP_RBX, x + 8);
+  veclisp_jit_mem(b, 1, "\x3b", VECLISP_RAX, VECLISP_RBX, y + 8);
+  set = veclisp_jit_jump(b, -1);
+  veclisp_jit_land(b, slow_x);
+  veclisp_jit_land(b, slow_y);
+  veclisp_jit_lea(b, VECLISP_RDI, VECLISP_RBX, x);
+  veclisp_jit_lea(b, VECLISP_RSI, VECLISP_RBX, y);
+  veclisp_jit_call(b, veclisp_jit_compare);
+  /* cmp eax, 0 */
+  veclisp_jit_byte(b, 0x83);
+  veclisp_jit_byte(b, 0xf8);
+  veclisp_jit_byte(b, 0x00);
+  veclisp_jit_land(b, set);
+  no = veclisp_jit_jump(b, cc ^ 1);
+  truth.type = VECLISP_SYM;
+  truth.as.sym = VECLISP_T;
+  veclisp_jit_const(b, t, truth);
+  done = veclisp_jit_jump(b, -1);
+  veclisp_jit_land(b, no);
+  veclisp_jit_const(b, t, veclisp_nil());
+  veclisp_jit_land(b, done);
+}
+/* (if TEST THEN ELSE) with @ bound in a scope of its own in the frame */
+void veclisp_jit_if(struct veclisp_jit_buf *b, struct veclisp_cell *args, int64_t t) {
+  int64_t s = veclisp_jit_temp(b, sizeof(struct veclisp_scope) + sizeof(struct veclisp_bindings));
+  int64_t at = s + sizeof(struct veclisp_scope);
+  int64_t test = at + offsetof(struct veclisp_bindings, value), then, then_nonnil, done, err = b->err;
+  struct veclisp_cell *rest = &args->as.pair[1].as.pair[1];
+  if (err < 0) {
+    veclisp_jit_const(b, t, veclisp_nil());
+    b->err = t;
+  }
+  veclisp_jit_expr(b, &args->as.pair[0], test);
+  b->err = err;
+  veclisp_jit_imm(b, VECLISP_RAX, (uint64_t)VECLISP_AT);
+  veclisp_jit_store(b, VECLISP_RBX, at + offsetof(struct veclisp_bindings, sym), VECLISP_RAX);
+  veclisp_jit_imm(b, VECLISP_RAX, 0);
+  veclisp_jit_store(b, VECLISP_RBX, at + offsetof(struct veclisp_bindings, next), VECLISP_RAX);
+  veclisp_jit_lea(b, VECLISP_RAX, VECLISP_RBX, at);
+  veclisp_jit_store(b, VECLISP_RBX, s + offsetof(struct veclisp_scope, bindings), VECLISP_RAX);
+  veclisp_jit_store(b, VECLISP_RBX, s + offsetof(struct veclisp_scope, next), VECLISP_R12);
+  veclisp_jit_mem(b, 0, "\x83", 7, VECLISP_RBX, test);
+  veclisp_jit_byte(b, VECLISP_PAIR);
+  then = veclisp_jit_jump(b, VECLISP_CC_NE);
+  veclisp_jit_mem(b, 1, "\x83", 7, VECLISP_RBX, test + 8);
+  veclisp_jit_byte(b, 0);
+  then_nonnil = veclisp_jit_jump(b, VECLISP_CC_NE);
+  if (rest->type == VECLISP_PAIR && rest->as.pair != NULL) {
+    veclisp_jit_lea(b, VECLISP_R12, VECLISP_RBX, s);
+    veclisp_jit_expr(b, &rest->as.pair[0], t);
+    veclisp_jit_load(b, VECLISP_R12, VECLISP_RBX, s + offsetof(struct veclisp_scope, next));
+  } else {
+    veclisp_jit_const(b, t, veclisp_nil());
+  }
+  done = veclisp_jit_jump(b, -1);
+  veclisp_jit_land(b, then);
+  veclisp_jit_land(b, then_nonnil);
+  veclisp_jit_lea(b, VECLISP_R12, VECLISP_RBX, s);
+  veclisp_jit_expr(b, &args->as.pair[1].as.pair[0], t);
+  veclisp_jit_load(b, VECLISP_R12, VECLISP_RBX, s + offsetof(struct veclisp_scope, next));
+  veclisp_jit_land(b, done);
+}
+/* a call through the head symbol's binding. arguments are evaluated
+   into the frame when the head wants them evaluated. */
+void veclisp_jit_generic(struct veclisp_jit_buf *b, struct veclisp_cell *site, int64_t n, int64_t t) {
+  struct veclisp_cell *a;
+  int64_t head = veclisp_jit_temp(b, 16), args = veclisp_jit_temp(b, 16 * n), i = 0, rest, done;
+  veclisp_jit_mov(b, VECLISP_RDI, VECLISP_R12);
+  veclisp_jit_imm(b, VECLISP_RSI, (uint64_t)site);
+  veclisp_jit_lea(b, VECLISP_RDX, VECLISP_RBX, head);
+  veclisp_jit_call(b, veclisp_call_head);
+  veclisp_jit_byte(b, 0x85);
+  veclisp_jit_byte(b, 0xc0);
+  rest = veclisp_jit_jump(b, VECLISP_CC_E);
+  FORPAIR(a, &site[1]) veclisp_jit_expr(b, &a->as.pair[0], args + 16 * i++);
+  veclisp_jit_mov(b, VECLISP_RDI, VECLISP_R12);
+  veclisp_jit_lea(b, VECLISP_RSI, VECLISP_RBX, head);
+  veclisp_jit_lea(b, VECLISP_RDX, VECLISP_RBX, args);
+  veclisp_jit_imm(b, VECLISP_RCX, n);
+  veclisp_jit_lea(b, VECLISP_R8, VECLISP_RBX, t);
+  veclisp_jit_call(b, veclisp_call_apply);
+  veclisp_jit_check(b, t);
+  done = veclisp_jit_jump(b, -1);
+  veclisp_jit_land(b, rest);
+  veclisp_jit_mov(b, VECLISP_RDI, VECLISP_R12);
+  veclisp_jit_lea(b, VECLISP_RSI, VECLISP_RBX, head);
+  veclisp_jit_imm(b, VECLISP_RDX, (uint64_t)site);
+  veclisp_jit_lea(b, VECLISP_RCX, VECLISP_RBX, t);
+  veclisp_jit_call(b, veclisp_call_rest);
+  veclisp_jit_check(b, t);
+  veclisp_jit_land(b, done);
+}
+/* emits code leaving the value of *form in the frame cell at t */
+void veclisp_jit_expr(struct veclisp_jit_buf *b, struct veclisp_cell *form, int64_t t) {
+  struct veclisp_bindings *binding;
+  struct veclisp_cell *a, *args;
+  int64_t n = 0, op, i, saved = b->frame;
+  switch (form->type) {
+  case VECLISP_INT:
+  case VECLISP_LAZY:
+  case VECLISP_BYTES:
+  case VECLISP_CHAN:
+    veclisp_jit_const(b, t, *form);
+    return;
+  case VECLISP_SYM:
+    if ((i = veclisp_jit_param(b->names, form->as.sym)) >= 0) {
+      veclisp_jit_copy(b, VECLISP_RBX, t, VECLISP_R13, i * sizeof(struct veclisp_bindings) + offsetof(struct veclisp_bindings, value));
+    } else {
+      veclisp_jit_mov(b, VECLISP_RDI, VECLISP_R12);
+      veclisp_jit_imm(b, VECLISP_RSI, (uint64_t)form->as.sym);
+      veclisp_jit_lea(b, VECLISP_RDX, VECLISP_RBX, t);
+      veclisp_jit_call(b, veclisp_jit_var);
+    }
+    return;
+  case VECLISP_PAIR:
+    if (form->as.pair == NULL) {
+      veclisp_jit_const(b, t, *form);
+      return;
+    }
+    break;
+  default:
+    veclisp_jit_delegate(b, form, t);
+    return;
+  }
+  args = &form->as.pair[1];
+  op = veclisp_jit_op(b, form->as.pair[0], &binding);
+  if (op == (int64_t)veclisp_n_quote) {
+    veclisp_jit_guard(b, form->as.pair[0].as.sym, binding);
+    veclisp_jit_imm(b, VECLISP_RDX, (uint64_t)args);
+    veclisp_jit_copy(b, VECLISP_RBX, t, VECLISP_RDX, 0);
+    return;
+  }
+  FORPAIR(a, args) ++n;
+  if (a->type != VECLISP_PAIR || (op == 0 && form->as.pair[0].type != VECLISP_SYM)) {
+    veclisp_jit_delegate(b, form, t);
+  } else if (op == (int64_t)veclisp_n_add || op == (int64_t)veclisp_n_sub || op == (int64_t)veclisp_n_mul) {
+    veclisp_jit_guard(b, form->as.pair[0].as.sym, binding);
+    veclisp_jit_arith(b, op, args, t);
+  } else if (op == (int64_t)veclisp_n_if && n >= 2) {
+    veclisp_jit_guard(b, form->as.pair[0].as.sym, binding);
+    veclisp_jit_if(b, args, t);
+  } else if (op != 0 && op != (int64_t)veclisp_n_if && n == 2) {
+    veclisp_jit_guard(b, form->as.pair[0].as.sym, binding);
+    veclisp_jit_cmp(b, op, args, t);
+  } else {
+    veclisp_jit_generic(b, form->as.pair, n, t);
+  }
+  b->frame = saved;
+}
+int veclisp_jit_compile(struct veclisp_cell lambda, struct veclisp_jit *jit) {
+  struct veclisp_jit_buf b;
+  struct veclisp_cell *p;
+  int64_t frame_size, body, t;
+  uint32_t size;
+  void *code;
+  FORPAIR(p, &lambda.as.pair[0]) {
+    if (p->as.pair[0].type != VECLISP_SYM || p->as.pair[0].as.sym == VECLISP_AT
+        || p->as.pair[0].as.sym == VECLISP_UPVAL) return 1;
+  }
+  if (p->type != VECLISP_PAIR) return 1;
+  memset(&b, 0, sizeof(b));
+  b.err = -1;
+  b.names = lambda.as.pair[0];
+  b.jit = jit;
+  veclisp_jit_push(&b, VECLISP_RBP);
+  veclisp_jit_mov(&b, VECLISP_RBP, VECLISP_RSP);
+  veclisp_jit_push(&b, VECLISP_R12);
+  veclisp_jit_push(&b, VECLISP_R13);
+  veclisp_jit_push(&b, VECLISP_R14);
+  veclisp_jit_push(&b, VECLISP_RBX);
+  /* sub rsp, frame size */
+  veclisp_jit_byte(&b, 0x48);
+  veclisp_jit_byte(&b, 0x81);
+  veclisp_jit_byte(&b, 0xec);
+  frame_size = b.used;
+  veclisp_jit_u32(&b, 0);
+  veclisp_jit_mov(&b, VECLISP_RBX, VECLISP_RSP);
+  veclisp_jit_mov(&b, VECLISP_R12, VECLISP_RDI);
+  veclisp_jit_mov(&b, VECLISP_R13, VECLISP_RSI);
+  veclisp_jit_mov(&b, VECLISP_R14, VECLISP_RDX);
+  body = veclisp_jit_jump(&b, -1);
+  /* every exit restores the callee saved registers here, with the
+     status already in eax */
+  b.epilogue = b.used;
+  veclisp_jit_lea(&b, VECLISP_RSP, VECLISP_RBP, -32);
+  veclisp_jit_pop(&b, VECLISP_RBX);
+  veclisp_jit_pop(&b, VECLISP_R14);
+  veclisp_jit_pop(&b, VECLISP_R13);
+  veclisp_jit_pop(&b, VECLISP_R12);
+  veclisp_jit_pop(&b, VECLISP_RBP);
+  veclisp_jit_byte(&b, 0xc3);
+  veclisp_jit_land(&b, body);
+  t = veclisp_jit_temp(&b, 16);
+  veclisp_jit_const(&b, t, veclisp_nil());
+  FORPAIR(p, &lambda.as.pair[1]) veclisp_jit_expr(&b, &p->as.pair[0], t);
+  veclisp_jit_copy(&b, VECLISP_R14, 0, VECLISP_RBX, t);
+  /* xor eax, eax */
+  veclisp_jit_byte(&b, 0x31);
+  veclisp_jit_byte(&b, 0xc0);
+  veclisp_jit_jump_back(&b, b.epilogue);
+  size = (b.max_frame + 15) & ~15;
+  memcpy(&b.code[frame_size], &size, 4);
+  code = mmap(NULL, b.used, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  if (code == MAP_FAILED) {
+    free(b.code);
+    return 1;
+  }
+  memcpy(code, b.code, b.used);
+  free(b.code);
+  if (mprotect(code, b.used, PROT_READ | PROT_EXEC)) {
+    munmap(code, b.used);
+    return 1;
+  }
+  jit->code = (veclisp_jit_func)code;
+  jit->size = b.used;
+  return 0;
+}
+#else
+int veclisp_jit_compile(struct veclisp_cell lambda, struct veclisp_jit *jit) {
+  return 1;
+}
+#endif
+void veclisp_jit_unmap(void *obj, void *client_data) {
+  struct veclisp_jit *jit = obj;
+  munmap((void *)jit->code, jit->size);
+}
+/* the code to run for a call of lambda, or NULL to interpret it. only a
+   frozen lambda, or one read in whole as a single form, is compiled, and
+   it goes back to the interpreter once anything in that form is written,
+   since the code would still run the body as it was. */
+veclisp_jit_func veclisp_jit_entry(struct veclisp_cell lambda) {
+  struct veclisp_interp *interp = veclisp_current;
+  struct veclisp_jit *jit = veclisp_ptrmap_get(&interp->jit_entries, lambda.as.pair);
+  struct veclisp_jit_count *count;
+  if (jit == NULL) {
+    count = &interp->jit_counts[((uint64_t)lambda.as.pair >> 4) & (VECLISP_JIT_COUNTS - 1)];
+    if (count->lambda != GC_HIDE_POINTER(lambda.as.pair)) {
+      count->lambda = GC_HIDE_POINTER(lambda.as.pair);
+      count->calls = 0;
+    }
+    if (++count->calls < interp->jit_threshold || !veclisp_weak_key(lambda.as.pair)) return NULL;
+    count->lambda = 0;
+    jit = GC_malloc(sizeof(*jit));
+    veclisp_ptrmap_put(&interp->jit_entries, lambda.as.pair, jit);
+    if ((jit->literal = veclisp_literal(lambda.as.pair, 2)) != NULL)
+      jit->writes = __atomic_load_n(&jit->literal->writes, __ATOMIC_RELAXED);
+    if ((jit->literal == NULL ? !veclisp_frozen_p(lambda.as.pair) : !veclisp_literal_whole(lambda, jit->literal))
+        || veclisp_jit_compile(lambda, jit)) {
+      jit->rejected = 1;
+      interp->jit_rejected++;
+      return NULL;
+    }
+    GC_register_finalizer(jit, veclisp_jit_unmap, NULL, NULL, NULL);
+    interp->jit_compiled++;
+  }
+  if (jit->rejected) return NULL;
+  if (jit->literal != NULL && __atomic_load_n(&jit->literal->writes, __ATOMIC_RELAXED) != jit->writes) {
+    jit->rejected = 1;
+    interp->jit_deopts++;
+    return NULL;
+  }
+  if (!veclisp_guards_hold(jit->guards, jit->guard_count)) {
+    interp->jit_deopts++;
+    return NULL;
+  }
+  return jit->code;
+}
+/* (jit THRESHOLD) compiles lambdas after THRESHOLD calls; (jit ()) turns
+   that off again. returns the previous threshold. */
+int veclisp_n_jit(struct veclisp_scope *scope, struct veclisp_cell args, struct veclisp_cell *result) {
+  struct veclisp_cell threshold = veclisp_nil();
+  if (args.as.pair != NULL && veclisp_eval(scope, args.as.pair[0], &threshold)) return 1;
+  if (threshold.type != VECLISP_INT && !(threshold.type == VECLISP_PAIR && threshold.as.pair == NULL)) {
+    result->type = VECLISP_SYM;
+    result->as.sym = VECLISP_ERR_EXPECTED_INT;
+    return 1;
+  }
+  if (veclisp_current->jit_threshold > 0) {
+    result->type = VECLISP_INT;
+    result->as.integer = veclisp_current->jit_threshold;
+  } else *result = veclisp_nil();
+  veclisp_current->jit_threshold = threshold.type == VECLISP_INT ? threshold.as.integer : 0;
+  return 0;
+}
+/* (jit-stats) is (compiled rejected deopts) */
+int veclisp_n_jitstats(struct veclisp_scope *scope, struct veclisp_cell args, struct veclisp_cell *result) {
+  struct veclisp_cell *p;
+  int64_t stats[3], i;
+  stats[0] = veclisp_current->jit_compiled;
+  stats[1] = veclisp_current->jit_rejected;
+  stats[2] = veclisp_current->jit_deopts;
+  result->type = VECLISP_PAIR;
+  result->as.pair = veclisp_alloc_pair();
+  for (i = 0, p = result; i < 3; ++i) {
+    p->as.pair[0].type = VECLISP_INT;
+    p->as.pair[0].as.integer = stats[i];
+    p->as.pair[1].type = VECLISP_PAIR;
+    p->as.pair[1].as.pair = i < 2 ? veclisp_alloc_pair() : NULL;
+    p = &p->as.pair[1];
+  }
+  return 0;
+}
+/* embedding api */
+void veclisp_interp_enter(struct veclisp_interp *interp) {
+  veclisp_current = interp;
+}
+struct veclisp_scope *veclisp_interp_scope(struct veclisp_interp *interp) {
+  return &interp->root;
+}
+/* evaluates every form in buf with *In bound to it, like load does for
+   files. result is the value of the last form, or the error. */
+int veclisp_eval_buffer(struct veclisp_interp *interp, const char *buf, size_t len, struct veclisp_cell *result) {
+  FILE *in;
+  struct veclisp_cell form;
+  struct veclisp_scope buffer_scope;
+  struct veclisp_bindings buffer_bindings;
+  veclisp_interp_enter(interp);
+  *result = veclisp_nil();
+  if (len == 0) return 0;
+  if ((in = fmemopen((void *)buf, len, "r")) == NULL) {
+    result->type = VECLISP_SYM;
+    result->as.sym = veclisp_intern(strerror(errno));
+    return 1;
+  }
+  buffer_scope.next = &interp->root;
+  buffer_scope.bindings = &buffer_bindings;
+  buffer_bindings.next = NULL;
+  buffer_bindings.sym = VECLISP_INPORT;
+  buffer_bindings.value.type = VECLISP_INT;
+  buffer_bindings.value.as.integer = (int64_t)in;
+  for (;;) {
+    if (veclisp_read(&buffer_scope, &form)) {
+      if (form.type == VECLISP_INT && form.as.integer == EOF) break;
+      *result = form;
+      fclose(in);
+      return 1;
+    }
+    if (veclisp_eval(&buffer_scope, form, result)) {
+      fclose(in);
+      return 1;
+    }
+  }
+  fclose(in);
+  return 0;
+}
+int veclisp_load_file(struct veclisp_interp *interp, const char *path, struct veclisp_cell *result) {
+  FILE *in;
+  int failed;
+  veclisp_interp_enter(interp);
+  if ((in = fopen(path, "r")) == NULL) return veclisp_errno_err(result);
+  failed = veclisp_load_stream(&interp->root, in, 0, result);
+  fclose(in);
+  return failed;
+}
+/* applies the global function name to args, a list of values */
+int veclisp_call(struct veclisp_interp *interp, const char *name, struct veclisp_cell args, struct veclisp_cell *result) {
+  struct veclisp_cell fun;
+  veclisp_interp_enter(interp);
+  if (veclisp_scope_lookup(&interp->root, veclisp_intern(name), &fun)) {
+    *result = fun;
+    return 1;
+  }
+  return veclisp_lambda(&interp->root, fun, args, result);
+}
+void veclisp_register(struct veclisp_interp *interp, const char *name, veclisp_native_func fn) {
+  struct veclisp_cell value;
+  veclisp_interp_enter(interp);
+  value.type = VECLISP_INT;
+  value.as.integer = (int64_t)fn;
+  veclisp_set(&interp->root, veclisp_intern(name), value);
+}
+struct veclisp_cell *veclisp_root(struct veclisp_cell value) {
+  struct veclisp_cell *root = GC_malloc_uncollectable(sizeof(*root));
+  if (root != NULL) *root = value;
+  return root;
+}
+void veclisp_unroot(struct veclisp_cell *root) {
+  GC_free(root);
+}
+int veclisp_thread_attach(void) {
+  struct GC_stack_base base;
+  int err;
+  if (GC_get_stack_base(&base) != GC_SUCCESS) return -1;
+  err = GC_register_my_thread(&base);
+  return err == GC_SUCCESS || err == GC_DUPLICATE ? 0 : -1;
+}
+void veclisp_thread_detach(void) {
+  veclisp_current = NULL;
+  GC_unregister_my_thread();
+}
+struct veclisp_cell veclisp_nil(void) {
+  struct veclisp_cell nil;
+  nil.type = VECLISP_PAIR;
+  nil.as.pair = NULL;
+  return nil;
+}
+struct veclisp_cell veclisp_from_int(int64_t n) {
+  struct veclisp_cell value;
+  value.type = VECLISP_INT;
+  value.as.integer = n;
+  return value;
+}
+struct veclisp_cell veclisp_from_sym(const char *sym) {
+  struct veclisp_cell value;
+  value.type = VECLISP_SYM;
+  value.as.sym = veclisp_intern(sym);
+  return value;
+}
+struct veclisp_cell veclisp_from_bytes(const void *data, size_t len) {
+  struct veclisp_cell value;
+  value.type = VECLISP_BYTES;
+  value.as.bytes = veclisp_alloc_bytes(len, len);
+  memcpy(value.as.bytes->data, data, len);
+  return value;
+}
+struct veclisp_cell veclisp_cons(struct veclisp_cell head, struct veclisp_cell tail) {
+  struct veclisp_cell value;
+  value.type = VECLISP_PAIR;
+  value.as.pair = veclisp_alloc_pair();
+  value.as.pair[0] = head;
+  value.as.pair[1] = tail;
+  return value;
+}
+int veclisp_to_int(struct veclisp_cell value, int64_t *n) {
+  if (value.type != VECLISP_INT) return 1;
+  *n = value.as.integer;
+  return 0;
+}
+const char *veclisp_to_sym(struct veclisp_cell value) {
+  return value.type == VECLISP_SYM ? value.as.sym : NULL;
+}
+const void *veclisp_to_bytes(struct veclisp_cell value, size_t *len) {
+  if (value.type != VECLISP_BYTES) return NULL;
+  *len = value.as.bytes->length;
+  return value.as.bytes->data;
+}
+/* the printed form of value, in a malloc'd string the caller frees */
+char *veclisp_to_text(struct veclisp_cell value) {
+  char *text = NULL;
+  size_t len = 0;
+  FILE *out = open_memstream(&text, &len);
+  if (out == NULL) return NULL;
+  veclisp_fwrite(out, value);
+  fclose(out);
+  return text;
+}
+
+/* pre-forking server. the parent has already loaded whatever the
+   workers need, so each fork shares that heap copy-on-write and a
+   connection costs nothing but an accept. every connection is one
+   request: the forms it sends are evaluated with *In, *Out and *Err
+   bound to it, and each result is written back on its own line. a
+   worker exits after max_requests connections (0 for never) and the
+   parent forks a fresh one from the untouched heap. */
+volatile sig_atomic_t veclisp_serve_stopping;
+void veclisp_serve_stop(int sig) {
+  veclisp_serve_stopping = 1;
+}
+void veclisp_serve_session(struct veclisp_interp *interp, int conn) {
+  FILE *in, *out;
+  struct veclisp_cell form, value;
+  struct veclisp_scope session_scope;
+  struct veclisp_bindings bindings[3];
+  int i;
+  if ((in = fdopen(conn, "r")) == NULL) {
+    close(conn);
+    return;
+  }
+  if ((out = fdopen(dup(conn), "w")) == NULL) {
+    fclose(in);
+    return;
+  }
+  session_scope.next = &interp->root;
+  session_scope.bindings = bindings;
+  bindings[0].sym = VECLISP_INPORT;
+  bindings[0].value.as.integer = (int64_t)in;
+  bindings[1].sym = VECLISP_OUTPORT;
+  bindings[1].value.as.integer = (int64_t)out;
+  bindings[2].sym = VECLISP_ERRPORT;
+  bindings[2].value.as.integer = (int64_t)out;
+  for (i = 0; i < 3; ++i) {
+    bindings[i].value.type = VECLISP_INT;
+    bindings[i].next = i < 2 ? &bindings[i + 1] : NULL;
+  }
+  for (;;) {
+    if (veclisp_read(&session_scope, &form)) {
+      if (form.type == VECLISP_INT && form.as.integer == EOF) break;
+      veclisp_print_err(&session_scope, form);
+    } else if (veclisp_eval(&session_scope, form, &value)) {
+      veclisp_print_err(&session_scope, value);
+    } else {
+      veclisp_write(&session_scope, value);
+      fputc('\n', out);
+    }
+    /* a client waiting on this reply before sending more must get it */
+    fflush(out);
+  }
+  fclose(out);
+  fclose(in);
+}
+void veclisp_serve_worker(struct veclisp_interp *interp, int fd, int64_t max_requests) {
+  int64_t served;
+  int conn;
+  signal(SIGINT, SIG_DFL);
+  signal(SIGTERM, SIG_DFL);
+  /* each worker draws its own random numbers */
+  interp->rand_seeded = 0;
+  /* an epoll set would be shared with the parent, so start without one */
+  if (interp->event_loop.watches != NULL) {
+    close(interp->event_loop.epoll_fd);
+    memset(&interp->event_loop, 0, sizeof(interp->event_loop));
+  }
+  for (served = 0; max_requests == 0 || served < max_requests; ++served) {
+    if ((conn = accept(fd, NULL, NULL)) < 0) {
+      if (errno == EINTR || errno == ECONNABORTED) {
+        --served;
+        continue;
+      }
+      _exit(1);
+    }
+    veclisp_serve_session(interp, conn);
+  }
+  _exit(0);
+}
+pid_t veclisp_serve_fork(struct veclisp_interp *interp, int fd, int64_t max_requests) {
+  pid_t pid;
+  fflush(NULL);
+  if ((pid = fork()) == 0) veclisp_serve_worker(interp, fd, max_requests);
+  return pid;
+}
+int veclisp_serve(struct veclisp_interp *interp, const char *path, int workers, int64_t max_requests) {
+  int fd, i, status;
+  pid_t pid, *pids;
+  struct sockaddr_un addr;
+  struct sigaction stop;
+  veclisp_interp_enter(interp);
+  if (strlen(path) >= sizeof(addr.sun_path)) {
+    errno = ENAMETOOLONG;
+    return -1;
+  }
+  memset(&addr, 0, sizeof(addr));
+  addr.sun_family = AF_UNIX;
+  strcpy(addr.sun_path, path);
+  unlink(path);
+  if ((fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0)) < 0) return -1;
+  if (bind(fd, (struct sockaddr *)&addr, sizeof(addr)) || listen(fd, SOMAXCONN)) {
+    close(fd);
+    return -1;
+  }
+  memset(&stop, 0, sizeof(stop));
+  stop.sa_handler = veclisp_serve_stop;
+  sigaction(SIGINT, &stop, NULL);
+  sigaction(SIGTERM, &stop, NULL);
+  signal(SIGPIPE, SIG_IGN);
+  veclisp_serve_stopping = 0;
+  pids = calloc(workers, sizeof(*pids));
+  for (i = 0; i < workers; ++i) pids[i] = veclisp_serve_fork(interp, fd, max_requests);
+  while (!veclisp_serve_stopping) {
+    if ((pid = waitpid(-1, &status, 0)) < 0) {
+      if (errno == EINTR) continue;
+      break;
+    }
+    for (i = 0; i < workers; ++i) {
+      if (pids[i] == pid) pids[i] = veclisp_serve_fork(interp, fd, max_requests);
+    }
+  }
+  for (i = 0; i < workers; ++i) {
+    if (pids[i] > 0) kill(pids[i], SIGTERM);
+  }
+  while (waitpid(-1, &status, 0) > 0 || errno == EINTR);
+  free(pids);
+  close(fd);
+  unlink(path);
+  signal(SIGINT, SIG_DFL);
+  signal(SIGTERM, SIG_DFL);
+  return 0;
+}
@@ -0,0 +1,301 @@
+/****************************************
+ * veclisp.h                            *
+ * declarations for embedding veclisp   *
+ * and writing native functions         *
+ *                                      *
+ * author: jordan@yonder.computer       *
+ * license: MIT                         *
+ ****************************************/
+
+#ifndef VECLISP_H
+#define VECLISP_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+enum veclisp_type
+  { VECLISP_INT,
+    VECLISP_SYM,
+    VECLISP_VEC,
+    VECLISP_PAIR,
+    VECLISP_LAZY,
+    VECLISP_BYTES,
+    VECLISP_CHAN,
+  };
+struct veclisp_cell {
+  enum veclisp_type type;
+  union {
+    int64_t integer;
+    char *sym;
+    struct veclisp_cell *vec;
+    struct veclisp_cell *pair;
+    struct veclisp_lazy *lazy;
+    struct veclisp_bytes *bytes;
+    struct veclisp_chan *chan;
+  } as;
+};
+enum veclisp_bytes_flags
+  { VECLISP_BYTES_READONLY = 1,
+    VECLISP_BYTES_VIEW = 2,
+    VECLISP_BYTES_MAPPED = 4,
+  };
+struct veclisp_bytes {
+  int64_t length, capacity;
+  unsigned char *data;
+  enum veclisp_bytes_flags flags;
+  /* a view keeps the storage it points into alive through its owner */
+  struct veclisp_bytes *owner;
+};
+struct veclisp_bindings {
+  char *sym;
+  struct veclisp_cell value;
+  struct veclisp_bindings *next;
+};
+struct veclisp_scope {
+  struct veclisp_bindings *bindings;
+  struct veclisp_scope *next;
+};
+struct veclisp_interp;
+/* flags kept in the byte before an interned symbol's name */
+enum
+  { VECLISP_SYM_REBOUND = 1,
+    VECLISP_SYM_FOLDED = 2,
+    VECLISP_SYM_SPECIAL = 4,
+    VECLISP_SYM_SHADOWED = 8,
+  };
+typedef int (*veclisp_native_func)(struct veclisp_scope *, struct veclisp_cell, struct veclisp_cell *);
+/* a pair whose head is a closure func is called with its tail as data
+   and the evaluated arguments */
+typedef int (*veclisp_closure_func)(struct veclisp_scope *, struct veclisp_cell, struct veclisp_cell, struct veclisp_cell *);
+
+extern char *VECLISP_UPVAL, *VECLISP_AT, *VECLISP_T, *VECLISP_OUTPORT, *VECLISP_INPORT, *VECLISP_ERRPORT, *VECLISP_PROMPT, *VECLISP_DEFAULT_PROMPT, *VECLISP_QUOTE, *VECLISP_QUASIQUOTE, *VECLISP_UNQUOTE, *VECLISP_MAP, *VECLISP_FILTER, *VECLISP_TAKE, *VECLISP_DROP, *VECLISP_FOLD, *VECLISP_ERR_INVALID_STAGE, *VECLISP_ERR_INVALID_STEP, *VECLISP_ERR_EXPECTED_BYTES, *VECLISP_ERR_READ_ONLY, *VECLISP_ERR_OUT_OF_RANGE, *VECLISP_AGAIN, *VECLISP_ERR_EXPECTED_CHAN, *VECLISP_ERR_CHAN_CLOSED, *VECLISP_ERR_DEADLOCK, *VECLISP_ERR_CANNOT_FREEZE, *VECLISP_ERR_FROZEN_FULL, *VECLISP_ERR_EXPECTED_MEMO, *VECLISP_ERR_EXPECTED_ISOLATE, *VECLISP_ERR_ISOLATE_JOINED, *VECLISP_ERR_EXPECTED_VEC, *VECLISP_ERR_EXPECTED_GROWABLE, *VECLISP_RESPONSE, *VECLISP_LEXICAL, *VECLISP_DEFAULT_RESPONSE, *VECLISP_ERR_ILLEGAL_DOTTED_LIST, *VECLISP_ERR_EXPECTED_CLOSE_PAREN, *VECLISP_ERR_CANNOT_EXEC_VEC, *VECLISP_ERR_INVALID_NAME, *VECLISP_ERR_EXPECTED_PAIR, *VECLISP_ERR_ILLEGAL_LAMBDA_LIST, *VECLISP_ERR_EXPECTED_INT, *VECLISP_ERR_INVALID_SEQUENCE;
+
+/* embedding. every call works on the interpreter given to it, which also
+   becomes the current one for the calling thread. */
+struct veclisp_interp *veclisp_interp_new(void);
+void veclisp_interp_free(struct veclisp_interp *interp);
+void veclisp_interp_enter(struct veclisp_interp *interp);
+struct veclisp_scope *veclisp_interp_scope(struct veclisp_interp *interp);
+int veclisp_eval_buffer(struct veclisp_interp *interp, const char *buf, size_t len, struct veclisp_cell *result);
+int veclisp_load_file(struct veclisp_interp *interp, const char *path, struct veclisp_cell *result);
+int veclisp_call(struct veclisp_interp *interp, const char *name, struct veclisp_cell args, struct veclisp_cell *result);
+void veclisp_register(struct veclisp_interp *interp, const char *name, veclisp_native_func fn);
+/* a value kept where the collector does not look, such as memory from
+   malloc, must be held through a root. veclisp_root returns a cell the
+   collector always scans, holding value, or NULL if it cannot be had;
+   veclisp_unroot gives it back. */
+struct veclisp_cell *veclisp_root(struct veclisp_cell value);
+void veclisp_unroot(struct veclisp_cell *root);
+/* a thread the host started itself attaches before its first call in
+   here and detaches before it exits. threads started with pthread_create
+   by code that includes gc.h with GC_THREADS need neither. attach
+   returns -1 if the thread cannot be registered with the collector. */
+int veclisp_thread_attach(void);
+void veclisp_thread_detach(void);
+struct veclisp_cell veclisp_nil(void);
+struct veclisp_cell veclisp_from_int(int64_t n);
+struct veclisp_cell veclisp_from_sym(const char *sym);
+struct veclisp_cell veclisp_from_bytes(const void *data, size_t len);
+struct veclisp_cell veclisp_cons(struct veclisp_cell head, struct veclisp_cell tail);
+int veclisp_to_int(struct veclisp_cell value, int64_t *n);
+const char *veclisp_to_sym(struct veclisp_cell value);
+const void *veclisp_to_bytes(struct veclisp_cell value, size_t *len);
+char *veclisp_to_text(struct veclisp_cell value);
+/* serves path with workers forked from interp until SIGINT or SIGTERM.
+   returns -1 with errno set if the socket cannot be set up. */
+int veclisp_serve(struct veclisp_interp *interp, const char *path, int workers, int64_t max_requests);
+
+/* the evaluator */
+struct veclisp_cell *veclisp_alloc_pair(void);
+struct veclisp_cell *veclisp_alloc_vec(int64_t len);
+char *veclisp_intern(const char *sym);
+void veclisp_print_err(struct veclisp_scope *scope, struct veclisp_cell err);
+int veclisp_init_root_scope(struct veclisp_scope *root_scope);
+int veclisp_scope_lookup(struct veclisp_scope *scope, char *sym, struct veclisp_cell *result);
+int veclisp_read(struct veclisp_scope *scope, struct veclisp_cell *result);
+int veclisp_eval(struct veclisp_scope *scope, struct veclisp_cell value, struct veclisp_cell *result);
+int veclisp_lambda(struct veclisp_scope *parent_scope, struct veclisp_cell lambda, struct veclisp_cell args, struct veclisp_cell *result);
+void veclisp_write(struct veclisp_scope *scope, struct veclisp_cell value);
+void veclisp_set(struct veclisp_scope *scope, char *interned_sym, struct veclisp_cell value);
+void veclisp_fwrite(FILE *out, struct veclisp_cell value);
+int veclisp_force(struct veclisp_scope *scope, struct veclisp_cell value, struct veclisp_cell *result);
+int veclisp_apply1(struct veclisp_scope *scope, struct veclisp_cell fun, struct veclisp_cell x, struct veclisp_cell *result);
+int veclisp_apply2(struct veclisp_scope *scope, struct veclisp_cell fun, struct veclisp_cell x, struct veclisp_cell y, struct veclisp_cell *result);
+int veclisp_eval_int(struct veclisp_scope *scope, struct veclisp_cell expr, int64_t *value, struct veclisp_cell *result);
+struct veclisp_bytes *veclisp_alloc_bytes(int64_t length, int64_t capacity);
+int veclisp_compare(struct veclisp_cell x, struct veclisp_cell y);
+void veclisp_rebind(char *sym);
+void veclisp_rebind_local(char *sym);
+
+/* support for compiled code. a call form's head is looked up through
+   its site's cache; call_head is nonzero when the head wants its
+   arguments evaluated, for call_apply, and call_rest runs the others. */
+struct veclisp_guard {
+  char *sym;
+  struct veclisp_bindings *binding;
+  int64_t value;
+};
+int veclisp_call_head(struct veclisp_scope *scope, struct veclisp_cell *site, struct veclisp_cell *head);
+struct veclisp_cell veclisp_call_list(struct veclisp_cell *cells, struct veclisp_cell *args, int64_t n);
+int veclisp_call_apply(struct veclisp_scope *scope, struct veclisp_cell *head, struct veclisp_cell *args, int64_t n, struct veclisp_cell *result);
+int veclisp_call_rest(struct veclisp_scope *scope, struct veclisp_cell *head, struct veclisp_cell *site, struct veclisp_cell *result);
+int veclisp_guards_hold(struct veclisp_guard *guards, int64_t n);
+struct veclisp_guard *veclisp_guard_natives(struct veclisp_scope *root, const char **syms, veclisp_native_func *natives, int64_t n);
+void veclisp_bind_args(struct veclisp_bindings *b, char **names, int64_t n, struct veclisp_cell args);
+/* defined by the output of veclisp-compile when built with it */
+int veclisp_compiled(struct veclisp_scope *root, struct veclisp_cell *result);
+
+/* builtins. natives receive their arguments unevaluated */
+int veclisp_n_begin(struct veclisp_scope *, struct veclisp_cell, struct veclisp_cell *);
+int veclisp_n_call(struct veclisp_scope *scope, struct veclisp_cell args, struct veclisp_cell *result);
+int veclisp_n_quote(struct veclisp_scope *, struct veclisp_cell, struct veclisp_cell *);
+int veclisp_n_quasiquote(struct veclisp_scope *, struct veclisp_cell, struct veclisp_cell *);
+int veclisp_n_intp(struct veclisp_scope *, struct veclisp_cell, struct veclisp_cell *);
+int veclisp_n_symp(struct veclisp_scope *, struct veclisp_cell, struct veclisp_cell *);
+int veclisp_n_vecp(struct veclisp_scope *, struct veclisp_cell, struct veclisp_cell *);
+int veclisp_n_pairp(struct veclisp_scope *, struct veclisp_cell, struct veclisp_cell *);
+int veclisp_n_nilp(struct veclisp_scope *, struct veclisp_cell, struct veclisp_cell *);
+int veclisp_n_pair(struct veclisp_scope *, struct veclisp_cell, struct veclisp_cell *);
+int veclisp_n_head(struct veclisp_scope *, struct veclisp_cell, struct veclisp_cell *);
+int veclisp_n_tail(struct veclisp_scope *, struct veclisp_cell, struct veclisp_cell *);
+int veclisp_n_cmp(struct veclisp_scope *, struct veclisp_cell, struct veclisp_cell *);
+int veclisp_n_eq(struct veclisp_scope *, struct veclisp_cell, struct veclisp_cell *);
+int veclisp_n_gt(struct veclisp_scope *, struct veclisp_cell, struct veclisp_cell *);
+int veclisp_n_lt(struct veclisp_scope *, struct veclisp_cell, struct veclisp_cell *);
+int veclisp_n_gte(struct veclisp_scope *, struct veclisp_cell, struct veclisp_cell *);
+int veclisp_n_lte(struct veclisp_scope *, struct veclisp_cell, struct veclisp_cell *);
+int veclisp_n_set(struct veclisp_scope *, struct veclisp_cell, struct veclisp_cell *);
+int veclisp_n_syms(struct veclisp_scope *, struct veclisp_cell, struct veclisp_cell *);
+int veclisp_n_add(struct veclisp_scope *, struct veclisp_cell, struct veclisp_cell *);
+int veclisp_n_sub(struct veclisp_scope *, struct veclisp_cell, struct veclisp_cell *);
+int veclisp_n_mul(struct veclisp_scope *, struct veclisp_cell, struct veclisp_cell *);
+int veclisp_n_div(struct veclisp_scope *, struct veclisp_cell, struct veclisp_cell *);
+int veclisp_n_mod(struct veclisp_scope *, struct veclisp_cell, struct veclisp_cell *);
+int veclisp_n_exp(struct veclisp_scope *, struct veclisp_cell, struct veclisp_cell *);
+int veclisp_n_rsh(struct veclisp_scope *, struct veclisp_cell, struct veclisp_cell *);
+int veclisp_n_lsh(struct veclisp_scope *, struct veclisp_cell, struct veclisp_cell *);
+int veclisp_n_bitwiseand(struct veclisp_scope *, struct veclisp_cell, struct veclisp_cell *);
+int veclisp_n_bitwiseor(struct veclisp_scope *, struct veclisp_cell, struct veclisp_cell *);
+int veclisp_n_bitwisexor(struct veclisp_scope *, struct veclisp_cell, struct veclisp_cell *);
+int veclisp_n_bitwisenot(struct veclisp_scope *, struct veclisp_cell, struct veclisp_cell *);
+int veclisp_n_abs(struct veclisp_scope *, struct veclisp_cell, struct veclisp_cell *);
+int veclisp_n_sqrt(struct veclisp_scope *, struct veclisp_cell, struct veclisp_cell *);
+int veclisp_n_rand(struct veclisp_scope *, struct veclisp_cell, struct veclisp_cell *);
+int veclisp_n_randseed(struct veclisp_scope *, struct veclisp_cell, struct veclisp_cell *);
+int veclisp_n_randrange(struct veclisp_scope *, struct veclisp_cell, struct veclisp_cell *);
+int veclisp_n_randfill(struct veclisp_scope *, struct veclisp_cell, struct veclisp_cell *);
+int veclisp_n_and(struct veclisp_scope *, struct veclisp_cell, struct veclisp_cell *);
+int veclisp_n_or(struct veclisp_scope *, struct veclisp_cell, struct veclisp_cell *);
+int veclisp_n_max(struct veclisp_scope *, struct veclisp_cell, struct veclisp_cell *);
+int veclisp_n_min(struct veclisp_scope *, struct veclisp_cell, struct veclisp_cell *);
+int veclisp_n_vectorref(struct veclisp_scope *, struct veclisp_cell, struct veclisp_cell *);
+int veclisp_n_vectorset(struct veclisp_scope *, struct veclisp_cell, struct veclisp_cell *);
+int veclisp_n_length(struct veclisp_scope *, struct veclisp_cell, struct veclisp_cell *);
+int veclisp_n_eval(struct veclisp_scope *, struct veclisp_cell, struct veclisp_cell *);
+int veclisp_n_sethead(struct veclisp_scope *, struct veclisp_cell, struct veclisp_cell *);
+int veclisp_n_settail(struct veclisp_scope *, struct veclisp_cell, struct veclisp_cell *);
+int veclisp_n_locals(struct veclisp_scope *, struct veclisp_cell, struct veclisp_cell *);
+int veclisp_n_globals(struct veclisp_scope *, struct veclisp_cell, struct veclisp_cell *);
+int veclisp_n_list(struct veclisp_scope *, struct veclisp_cell, struct veclisp_cell *);
+int veclisp_n_load(struct veclisp_scope *, struct veclisp_cell, struct veclisp_cell *);
+int veclisp_n_macro(struct veclisp_scope *, struct veclisp_cell, struct veclisp_cell *);
+int veclisp_n_open(struct veclisp_scope *, struct veclisp_cell, struct veclisp_cell *);
+int veclisp_n_close(struct veclisp_scope *, struct veclisp_cell, struct veclisp_cell *);
+int veclisp_n_map(struct veclisp_scope *, struct veclisp_cell, struct veclisp_cell *);
+int veclisp_n_filter(struct veclisp_scope *, struct veclisp_cell, struct veclisp_cell *);
+int veclisp_n_let(struct veclisp_scope *, struct veclisp_cell, struct veclisp_cell *);
+int veclisp_n_read(struct veclisp_scope *, struct veclisp_cell, struct veclisp_cell *);
+int veclisp_n_throw(struct veclisp_scope *, struct veclisp_cell, struct veclisp_cell *);
+int veclisp_n_catch(struct veclisp_scope *, struct veclisp_cell, struct veclisp_cell *);
+int veclisp_n_writebytes(struct veclisp_scope *, struct veclisp_cell, struct veclisp_cell *);
+int veclisp_n_print(struct veclisp_scope *, struct veclisp_cell, struct veclisp_cell *);
+int veclisp_n_exit(struct veclisp_scope *, struct veclisp_cell, struct veclisp_cell *);
+int veclisp_n_write(struct veclisp_scope *, struct veclisp_cell, struct veclisp_cell *);
+int veclisp_n_pack(struct veclisp_scope *, struct veclisp_cell, struct veclisp_cell *);
+int veclisp_n_fold(struct veclisp_scope *, struct veclisp_cell, struct veclisp_cell *);
+int veclisp_n_no(struct veclisp_scope *, struct veclisp_cell, struct veclisp_cell *);
+int veclisp_n_yes(struct veclisp_scope *, struct veclisp_cell, struct veclisp_cell *);
+int veclisp_n_unfoldpair(struct veclisp_scope *, struct veclisp_cell, struct veclisp_cell *);
+int veclisp_n_unfoldvec(struct veclisp_scope *, struct veclisp_cell, struct veclisp_cell *);
+int veclisp_n_find(struct veclisp_scope *, struct veclisp_cell, struct veclisp_cell *);
+int veclisp_n_if(struct veclisp_scope *, struct veclisp_cell, struct veclisp_cell *);
+int veclisp_n_lazyunfold(struct veclisp_scope *, struct veclisp_cell, struct veclisp_cell *);
+int veclisp_n_lazyread(struct veclisp_scope *, struct veclisp_cell, struct veclisp_cell *);
+int veclisp_n_pipe(struct veclisp_scope *, struct veclisp_cell, struct veclisp_cell *);
+int veclisp_n_while(struct veclisp_scope *, struct veclisp_cell, struct veclisp_cell *);
+int veclisp_n_dotimes(struct veclisp_scope *, struct veclisp_cell, struct veclisp_cell *);
+int veclisp_n_forrange(struct veclisp_scope *, struct veclisp_cell, struct veclisp_cell *);
+int veclisp_n_range(struct veclisp_scope *, struct veclisp_cell, struct veclisp_cell *);
+int veclisp_n_bytes(struct veclisp_scope *, struct veclisp_cell, struct veclisp_cell *);
+int veclisp_n_makebytes(struct veclisp_scope *, struct veclisp_cell, struct veclisp_cell *);
+int veclisp_n_readline(struct veclisp_scope *, struct veclisp_cell, struct veclisp_cell *);
+int veclisp_n_readlineinto(struct veclisp_scope *, struct veclisp_cell, struct veclisp_cell *);
+int veclisp_n_readbytes(struct veclisp_scope *, struct veclisp_cell, struct veclisp_cell *);
+int veclisp_n_readbytesinto(struct veclisp_scope *, struct veclisp_cell, struct veclisp_cell *);
+int veclisp_n_mapfile(struct veclisp_scope *, struct veclisp_cell, struct veclisp_cell *);
+int veclisp_n_readallparallel(struct veclisp_scope *, struct veclisp_cell, struct veclisp_cell *);
+int veclisp_n_slice(struct veclisp_scope *, struct veclisp_cell, struct veclisp_cell *);
+int veclisp_n_subvec(struct veclisp_scope *, struct veclisp_cell, struct veclisp_cell *);
+int veclisp_n_vectorcopy(struct veclisp_scope *, struct veclisp_cell, struct veclisp_cell *);
+int veclisp_n_vectorfill(struct veclisp_scope *, struct veclisp_cell, struct veclisp_cell *);
+int veclisp_n_vectorconcat(struct veclisp_scope *, struct veclisp_cell, struct veclisp_cell *);
+int veclisp_n_makevector(struct veclisp_scope *, struct veclisp_cell, struct veclisp_cell *);
+int veclisp_n_vectorpush(struct veclisp_scope *, struct veclisp_cell, struct veclisp_cell *);
+int veclisp_n_vectorpop(struct veclisp_scope *, struct veclisp_cell, struct veclisp_cell *);
+int veclisp_n_vectorreserve(struct veclisp_scope *, struct veclisp_cell, struct veclisp_cell *);
+int veclisp_n_vectorcapacity(struct veclisp_scope *, struct veclisp_cell, struct veclisp_cell *);
+int veclisp_n_socketpair(struct veclisp_scope *, struct veclisp_cell, struct veclisp_cell *);
+int veclisp_n_unixlisten(struct veclisp_scope *, struct veclisp_cell, struct veclisp_cell *);
+int veclisp_n_unixconnect(struct veclisp_scope *, struct veclisp_cell, struct veclisp_cell *);
+int veclisp_n_accept(struct veclisp_scope *, struct veclisp_cell, struct veclisp_cell *);
+int veclisp_n_fdread(struct veclisp_scope *, struct veclisp_cell, struct veclisp_cell *);
+int veclisp_n_fdwrite(struct veclisp_scope *, struct veclisp_cell, struct veclisp_cell *);
+int veclisp_n_fdclose(struct veclisp_scope *, struct veclisp_cell, struct veclisp_cell *);
+int veclisp_n_fdport(struct veclisp_scope *, struct veclisp_cell, struct veclisp_cell *);
+int veclisp_n_flush(struct veclisp_scope *, struct veclisp_cell, struct veclisp_cell *);
+int veclisp_n_onreadable(struct veclisp_scope *, struct veclisp_cell, struct veclisp_cell *);
+int veclisp_n_onwritable(struct veclisp_scope *, struct veclisp_cell, struct veclisp_cell *);
+int veclisp_n_eventloop(struct veclisp_scope *, struct veclisp_cell, struct veclisp_cell *);
+int veclisp_n_spawn(struct veclisp_scope *, struct veclisp_cell, struct veclisp_cell *);
+int veclisp_n_yield(struct veclisp_scope *, struct veclisp_cell, struct veclisp_cell *);
+int veclisp_n_run(struct veclisp_scope *, struct veclisp_cell, struct veclisp_cell *);
+int veclisp_n_chan(struct veclisp_scope *, struct veclisp_cell, struct veclisp_cell *);
+int veclisp_n_chansend(struct veclisp_scope *, struct veclisp_cell, struct veclisp_cell *);
+int veclisp_n_chanrecv(struct veclisp_scope *, struct veclisp_cell, struct veclisp_cell *);
+int veclisp_n_chanclose(struct veclisp_scope *, struct veclisp_cell, struct veclisp_cell *);
+int veclisp_n_runisolate(struct veclisp_scope *, struct veclisp_cell, struct veclisp_cell *);
+int veclisp_n_freeze(struct veclisp_scope *, struct veclisp_cell, struct veclisp_cell *);
+int veclisp_n_frozenp(struct veclisp_scope *, struct veclisp_cell, struct veclisp_cell *);
+int veclisp_n_clock(struct veclisp_scope *, struct veclisp_cell, struct veclisp_cell *);
+int veclisp_n_memoize(struct veclisp_scope *, struct veclisp_cell, struct veclisp_cell *);
+int veclisp_n_memostats(struct veclisp_scope *, struct veclisp_cell, struct veclisp_cell *);
+int veclisp_n_optimize(struct veclisp_scope *, struct veclisp_cell, struct veclisp_cell *);
+int veclisp_n_lexical(struct veclisp_scope *, struct veclisp_cell, struct veclisp_cell *);
+int veclisp_n_special(struct veclisp_scope *, struct veclisp_cell, struct veclisp_cell *);
+int veclisp_n_callcachestats(struct veclisp_scope *, struct veclisp_cell, struct veclisp_cell *);
+int veclisp_n_jit(struct veclisp_scope *, struct veclisp_cell, struct veclisp_cell *);
+int veclisp_n_jitstats(struct veclisp_scope *, struct veclisp_cell, struct veclisp_cell *);
+int veclisp_n_joinisolate(struct veclisp_scope *, struct veclisp_cell, struct veclisp_cell *);
+
+#define FORNEXT(var, init) for (var = init; var != NULL; var = var->next)
+#define FORPAIR(var, init) for (var = init; var->type == VECLISP_PAIR && var->as.pair != NULL; var = &var->as.pair[1])
+/* a vector's first cell is its header. a fixed vector keeps its length
+   there and its elements after it. otherwise the header points at the
+   cell before the first element, the next cell holds the length and
+   the one after that the capacity: () for a slice sharing another
+   vector's storage, an integer for a growable vector, or the literal
+   a copy-on-write view shares until it is first written. */
+#define VECLISP_VLEN(v) ((v)[0].type == VECLISP_INT ? (v)[0].as.integer : (v)[1].as.integer)
+#define VECLISP_VELEMS(v) ((v)[0].type == VECLISP_INT ? (v) : (v)[0].as.vec)
+#define FORVEC(i, v) for (i = 1; i <= VECLISP_VLEN(v); ++i)
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif